@@ -1,10 +1,17 @@
-QT += core gui serialport
+QT += core gui serialport concurrent
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 TARGET = DeltaRobot
 TEMPLATE = app
 CONFIG += c++11 precompile_header
 
+# Vector instructions used by the batched inverse kinematics, SSE2 is used by
+# default on x86-64, build with "qmake CONFIG+=avx2" to use AVX2
+avx2 {
+    *-g++*|*clang*: QMAKE_CXXFLAGS += -mavx2
+    win32-msvc*: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
 # Precompiled headers
 PRECOMPILED_HEADER = stable.h
 
@@ -34,22 +41,67 @@ DEPENDPATH += $$PWD/Libraries/XJoystick
 
 SOURCES += main.cpp \ 
     dxl/dynamixel.cpp \
+    dxl/dxl_bus.cpp \
+    dxl/dxl_capture.cpp \
     dxl/dxl_hal.cpp \
+    dxl/dxl_parser.cpp \
+    dxl/dxl_port.cpp \
+    dxl/dxl_port_fault.cpp \
+    dxl/dxl_port_qt.cpp \
+    dxl/dxl_port_replay.cpp \
+    dxl/dxl_port_sim.cpp \
+    dxl/dxl_port_tty.cpp \
+    dxl/dxl_timeout.cpp \
+    dxl/dxl_protocol.cpp \
+    dxl/dxl_protocol1.cpp \
+    dxl/dxl_protocol2.cpp \
+    dxl/dxl_sim_ax12.cpp \
     mainwindow.cpp \
     optionswindow.cpp \
     servothread.cpp \
+    servobus.cpp \
+    servohealth.cpp \
+    servoinventory.cpp \
     dxl/ax12.cpp \
-    servofind.cpp
+    servofind.cpp \
+    loopscheduler.cpp \
+    trajectory.cpp \
+    kinematics.cpp \
+    workspacegrid.cpp
 
 HEADERS += \
+    dxl/dxl_bus.h \
+    dxl/dxl_capture.h \
+    dxl/dxl_clock.h \
     dxl/dxl_hal.h \
+    dxl/dxl_parser.h \
+    dxl/dxl_port.h \
+    dxl/dxl_port_fault.h \
+    dxl/dxl_port_qt.h \
+    dxl/dxl_port_replay.h \
+    dxl/dxl_port_sim.h \
+    dxl/dxl_port_tty.h \
+    dxl/dxl_timeout.h \
+    dxl/dxl_protocol.h \
+    dxl/dxl_protocol1.h \
+    dxl/dxl_protocol2.h \
+    dxl/dxl_ring.h \
+    dxl/dxl_sim_ax12.h \
     dxl/dynamixel.h \
     mainwindow.h \
     optionswindow.h \
     servothread.h \
+    servobus.h \
+    servohealth.h \
+    servoinventory.h \
     dxl/ax12.h \
     stable.h \
-    servofind.h
+    servofind.h \
+    loopscheduler.h \
+    trajectory.h \
+    kinematics.h \
+    workspacegrid.h \
+    triplebuffer.h
 
 FORMS += \
     mainwindow.ui \
@@ -0,0 +1,61 @@
+# Command line tool that measures the control loop throughput and the pick
+# and place cycle time, with the simulated servos by default
+QT += core gui serialport
+
+TARGET = busbench
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# Same vector instructions option as the controller
+avx2 {
+    *-g++*|*clang*: QMAKE_CXXFLAGS += -mavx2
+    win32-msvc*: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+INCLUDEPATH += ../.. ../../dxl
+
+SOURCES += main.cpp \
+    ../../kinematics.cpp \
+    ../../servobus.cpp \
+    ../../servohealth.cpp \
+    ../../dxl/ax12.cpp \
+    ../../dxl/dynamixel.cpp \
+    ../../dxl/dxl_bus.cpp \
+    ../../dxl/dxl_capture.cpp \
+    ../../dxl/dxl_hal.cpp \
+    ../../dxl/dxl_parser.cpp \
+    ../../dxl/dxl_port.cpp \
+    ../../dxl/dxl_port_fault.cpp \
+    ../../dxl/dxl_port_qt.cpp \
+    ../../dxl/dxl_port_replay.cpp \
+    ../../dxl/dxl_port_sim.cpp \
+    ../../dxl/dxl_port_tty.cpp \
+    ../../dxl/dxl_protocol.cpp \
+    ../../dxl/dxl_protocol1.cpp \
+    ../../dxl/dxl_protocol2.cpp \
+    ../../dxl/dxl_sim_ax12.cpp \
+    ../../dxl/dxl_timeout.cpp
+
+HEADERS += ../../kinematics.h \
+    ../../servobus.h \
+    ../../servohealth.h \
+    ../../dxl/ax12.h \
+    ../../dxl/dynamixel.h \
+    ../../dxl/dxl_bus.h \
+    ../../dxl/dxl_capture.h \
+    ../../dxl/dxl_clock.h \
+    ../../dxl/dxl_hal.h \
+    ../../dxl/dxl_parser.h \
+    ../../dxl/dxl_port.h \
+    ../../dxl/dxl_port_fault.h \
+    ../../dxl/dxl_port_qt.h \
+    ../../dxl/dxl_port_replay.h \
+    ../../dxl/dxl_port_sim.h \
+    ../../dxl/dxl_port_tty.h \
+    ../../dxl/dxl_protocol.h \
+    ../../dxl/dxl_protocol1.h \
+    ../../dxl/dxl_protocol2.h \
+    ../../dxl/dxl_ring.h \
+    ../../dxl/dxl_sim_ax12.h \
+    ../../dxl/dxl_timeout.h
@@ -0,0 +1,304 @@
+/// @file Tools/busbench/main.cpp Contains the servo bus benchmark
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+#include <QVector4D>
+
+#include <algorithm>
+#include <cmath>
+
+#include "kinematics.h"
+#include "servobus.h"
+#include "servohealth.h"
+#include "dxl/dxl_clock.h"
+
+/// Waypoints of a pick and place cycle, X, Y and Z in cm and the wrist
+/// angle in degrees
+static const double gPath[][4] = {
+    { -6.0,  3.0, 19.0, 150.0 },    // Over the piece
+    { -6.0,  3.0, 22.0, 150.0 },    // Pick
+    { -6.0,  3.0, 19.0, 150.0 },
+    {  6.0, -3.0, 19.0, 240.0 },    // Over the place, rotated
+    {  6.0, -3.0, 22.0, 240.0 },    // Place
+    {  6.0, -3.0, 19.0, 240.0 }
+};
+
+/// Servo angles of a position, false if it can't be reached
+/// @param k Robot kinematics
+/// @param p Position and wrist angle
+/// @param D Stores the angles of the 4 servos
+static bool angles(const Kinematics &k, const QVector4D &p, QVector<double> &D)
+{
+    k.inverse(p, D);
+    for (double d : D) if (qIsNaN(d)) return false;
+    return true;
+}
+
+/// Moves the robot like the controller does, reading the servos and
+/// sending the goal every cycle, until all the servos have arrived
+/// @param bus Servo bus
+/// @param goal Servo angles
+/// @param speed Speed in %
+/// @param tolerance Maximum angle error in degrees
+/// @param cycles Adds the control cycles used
+/// @return Time in ms, negative if the servos don't arrive in 5 s
+static double move(ServoBus &bus, const QVector<double> &goal, double speed,
+                   double tolerance, int &cycles)
+{
+    QVector<double> pos(goal.size(), -1), time(goal.size(), 0.0), ratio;
+    qint64 start = dxl_clock::ns();
+    
+    while (dxl_clock::ns() - start < 5000000000LL) {
+        bus.read();
+        bus.finish();
+        bus.getPositions(pos, time);
+        ++cycles;
+        
+        bool done = true;
+        for (int i = 0; i < goal.size(); ++i) {
+            if (pos[i] < 0 or qAbs(pos[i] - goal[i]) > tolerance) done = false;
+        }
+        if (done) return (dxl_clock::ns() - start) / 1000000.0;
+        
+        // The arm joints arrive together from where the move started
+        if (ratio.isEmpty()) ratio = ServoBus::speedRatios(pos, goal, 3);
+        bus.moveTo(goal, ratio, speed);
+        bus.finish();
+    }
+    return -1.0;
+}
+
+/// Runs the control loop following a circle, so every cycle reads the servos
+/// and sends new goals, and prints the cycle times. The failed reads are
+/// retried and estimated like the controller does. A cycle fails when a
+/// servo position couldn't be read, the recovery time goes from the first
+/// failed cycle to the next one that reads all the servos
+/// @param out Output stream
+/// @param bus Servo bus
+/// @param n Number of cycles
+/// @param speed Speed in %
+/// @return False if a point of the circle can't be reached
+static bool loop(QTextStream &out, ServoBus &bus, int n, double speed)
+{
+    if (n <= 0) return true;
+    
+    Kinematics k;
+    QVector<double> D(4), last(4, -1), pos(4, -1), time(4, 0.0);
+    QVector<int> retries(4, 0);
+    QVector<qint64> T(n), R;
+    ServoHealth health(4);
+    qint64 failedSince = -1;
+    int failed = 0, lost = 0;
+    for (int i = 0; i < n; ++i) {
+        double phi = 2.0*M_PI*i/500.0;
+        if (not angles(k, QVector4D(3.0*cos(phi), 3.0*sin(phi), 20.0, 150.0),
+                       D)) return false;
+        
+        qint64 start = dxl_clock::ns();
+        bus.read(start + 10000000);
+        bus.finish();
+        bus.getPositions(pos, time);
+        bus.getRetries(retries);
+        
+        bool valid = true;
+        for (double p : pos) if (p < 0) valid = false;
+        if (not health.update(pos, time, retries, start/1000000.0)) ++lost;
+        
+        // Every setpoint is a segment from the previous one
+        bus.moveTo(D, ServoBus::speedRatios(last, D, 3), speed);
+        last = D;
+        bus.finish();
+        qint64 end = dxl_clock::ns();
+        T[i] = end - start;
+        
+        if (not valid) {
+            ++failed;
+            if (failedSince < 0) failedSince = start;
+        }
+        else if (failedSince >= 0) {
+            R.append(end - failedSince);
+            failedSince = -1;
+        }
+    }
+    
+    std::sort(T.begin(), T.end());
+    double mean = 0;
+    for (qint64 t : T) mean += t/1000.0/n;
+    
+    out << "Control loop: " << n << " cycles, mean " << mean
+        << " us, median " << T[n/2]/1000.0 << " us, 99% "
+        << T[int(n*0.99)]/1000.0 << " us, max " << T.last()/1000.0
+        << " us, " << 1000000.0/mean << " Hz\n";
+    
+    if (failed > 0) {
+        double recovery = 0;
+        for (qint64 r : R) recovery += r/1000.0/qMax(1, R.size());
+        qint64 worst = R.isEmpty() ? 0 : *std::max_element(R.begin(), R.end());
+        out << "  " << failed << " failed cycles (" << 100.0*failed/n
+            << " %), recovery mean " << recovery << " us, max "
+            << worst/1000.0 << " us\n";
+    }
+    
+    quint64 retried = 0, good = 0;
+    for (int i = 0; i < 4; ++i) {
+        retried += health.stats(i).retries;
+        good += health.stats(i).recovered;
+    }
+    if (retried > 0 or lost > 0) {
+        out << "  " << retried << " retries, " << good << " good, " << lost
+            << " cycles with a lost servo\n";
+    }
+    // Every result as soon as it's measured, the runs are long
+    out.flush();
+    return true;
+}
+
+/// Measures the control loop throughput and the pick and place cycle time
+/// with the same servo code used by the controller. The default port is the
+/// simulated bus, so it runs without the robot; a real port gives the
+/// numbers of the robot
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("busbench");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Servo bus benchmark");
+    parser.addHelpOption();
+    
+    QCommandLineOption port({"p", "port"}, "Servo port, with the backend "
+                            "prefix.", "name", "sim:");
+    QCommandLineOption baud({"b", "baud"}, "Baud rate.", "bps", "1000000");
+    QCommandLineOption proto({"P", "protocol"}, "Protocol version, 1 or 2. "
+                             "The servos must have the AX-12 control table, "
+                             "2 is only for the simulated bus.", "version", 
+                             "1");
+    QCommandLineOption ids("ids", "IDs of the 4 servos.", "list", "1,2,3,4");
+    QCommandLineOption cycles({"n", "cycles"}, "Control loop cycles.", "n",
+                              "1000");
+    QCommandLineOption picks("picks", "Pick and place cycles.", "n", "5");
+    QCommandLineOption speed({"s", "speed"}, "Servo speed in %.", "%",
+                             "100");
+    QCommandLineOption faults("faults", "Repeats the control loop with "
+                              "these fault probabilities per status packet, "
+                              "see dxl_port_fault.", "list");
+    QCommandLineOption seed("seed", "Fault generator seed.", "n", "1");
+    parser.addOption(port);
+    parser.addOption(baud);
+    parser.addOption(proto);
+    parser.addOption(ids);
+    parser.addOption(cycles);
+    parser.addOption(picks);
+    parser.addOption(speed);
+    parser.addOption(faults);
+    parser.addOption(seed);
+    parser.process(a);
+    
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    bool ok[6];
+    int b = parser.value(baud).toInt(&ok[0]);
+    int version = parser.value(proto).toInt(&ok[1]);
+    int n = parser.value(cycles).toInt(&ok[2]);
+    int p = parser.value(picks).toInt(&ok[3]);
+    double s = parser.value(speed).toDouble(&ok[4]);
+    int r = parser.value(seed).toInt(&ok[5]);
+    
+    QVector<int> ID;
+    for (const QString &id : parser.value(ids).split(',')) {
+        bool valid;
+        ID.append(id.toInt(&valid));
+        if (not valid) ID.clear();
+    }
+    
+    QVector<double> F;
+    if (parser.isSet(faults)) {
+        for (const QString &f : parser.value(faults).split(',')) {
+            bool valid;
+            F.append(f.toDouble(&valid));
+            if (not valid or F.last() < 0 or F.last() > 1) ok[5] = false;
+        }
+    }
+    if (not (ok[0] and ok[1] and ok[2] and ok[3] and ok[4] and ok[5]) or
+        b <= 0 or n < 0 or p < 0 or s <= 0 or s > 100 or ID.size() != 4) {
+        err << "Invalid arguments\n";
+        return 1;
+    }
+    
+    ServoBus bus(QVector<int>({0, 1, 2, 3}));
+    bus.attach(parser.value(port), b, version);
+    if (not bus.isOpen()) {
+        err << "Cannot open " << parser.value(port) << "\n";
+        return 1;
+    }
+    bus.setup(ID, s, 1, 1);
+    
+    Kinematics k;
+    if (not loop(out, bus, n, s)) {
+        err << "The circle can't be reached\n";
+        return 1;
+    }
+    
+    // Pick and place starting over the piece
+    const int waypoints = sizeof(gPath)/sizeof(gPath[0]);
+    QVector< QVector<double> > goals(waypoints, QVector<double>(4));
+    for (int i = 0; i < waypoints; ++i) {
+        QVector4D w(gPath[i][0], gPath[i][1], gPath[i][2], gPath[i][3]);
+        if (not angles(k, w, goals[i])) {
+            err << "Waypoint " << i << " can't be reached\n";
+            return 1;
+        }
+    }
+    
+    int used = 0;
+    if (p > 0 and move(bus, goals[0], s, 1.0, used) < 0) {
+        err << "The servos don't reach the start position\n";
+        return 1;
+    }
+    
+    double total = 0;
+    int c = 0;
+    for (int i = 0; i < p; ++i) {
+        for (int j = 1; j <= waypoints; ++j) {
+            double ms = move(bus, goals[j % waypoints], s, 1.0, c);
+            if (ms < 0) {
+                err << "The servos don't reach the waypoint " << j % waypoints
+                    << "\n";
+                return 1;
+            }
+            total += ms;
+        }
+    }
+    
+    if (p > 0) {
+        out << "Pick and place: " << p << " cycles, " << total/p
+            << " ms per cycle, " << double(c)/p << " control cycles per "
+            << "cycle\n";
+    }
+    
+    // The same loop through a link that loses, corrupts and delays the
+    // status packets. The port is attached again, so the servos are set up
+    // again; a "sim:" port behind it is a new simulated bus
+    for (double f : F) {
+        QString faulty = QString("fault:drop=%1,flip=%1,truncate=%1,late=%1,"
+                                 "seed=%2@%3").arg(f).arg(r)
+                         .arg(parser.value(port));
+        bus.attach(faulty, b, version);
+        if (not bus.isOpen()) {
+            err << "Cannot open " << faulty << "\n";
+            return 1;
+        }
+        bus.setup(ID, s, 1, 1);
+        
+        out << "Faults " << f << ": ";
+        loop(out, bus, n, s);
+        
+        dxl_fault_stats injected = bus.faults();
+        out << "  " << injected.packets << " status packets, "
+            << injected.dropped << " dropped bytes, " << injected.flipped
+            << " flipped bits, " << injected.truncated << " truncated, "
+            << injected.late << " late\n";
+    }
+    return 0;
+}
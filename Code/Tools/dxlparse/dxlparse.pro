@@ -0,0 +1,24 @@
+# Command line tool that benchmarks the status packet parser with recorded
+# byte streams, it doesn't need any servo or serial port
+QT += core serialport
+QT -= gui
+
+TARGET = dxlparse
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ../.. ../../dxl
+
+SOURCES += main.cpp \
+    ../../dxl/dxl_capture.cpp \
+    ../../dxl/dxl_parser.cpp \
+    ../../dxl/dxl_protocol.cpp \
+    ../../dxl/dxl_protocol1.cpp \
+    ../../dxl/dxl_protocol2.cpp
+
+HEADERS += ../../dxl/dxl_capture.h \
+    ../../dxl/dxl_parser.h \
+    ../../dxl/dxl_protocol.h \
+    ../../dxl/dxl_protocol1.h \
+    ../../dxl/dxl_protocol2.h
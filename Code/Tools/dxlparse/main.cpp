@@ -0,0 +1,173 @@
+/// @file Tools/dxlparse/main.cpp Contains the status packet parser benchmark
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <random>
+
+#include "dxl/dxl_capture.h"
+#include "dxl/dynamixel.h"
+
+/// Generates a byte stream with status packets like the ones sent by the
+/// servos when their position is read, some of them with glitches
+/// @param protocol Packet format
+/// @param packets Number of status packets
+/// @param errors Probability of a glitch in every packet
+/// @param seed Random generator seed
+QByteArray generate(const dxl_protocol &protocol, int packets, double errors,
+                    unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_real_distribution<double> prob(0.0, 1.0);
+    
+    QByteArray stream;
+    unsigned char pkt[MAXNUM_TXPACKET];
+    for (int i = 0; i < packets; ++i) {
+        // Error byte and present position
+        unsigned char param[3] = { 0, (unsigned char)byte(gen),
+                                   (unsigned char)byte(gen) };
+        
+        // The 1.0 error byte is where the instruction is, 2.0 has both
+        int n = protocol.version() == 1 ?
+            protocol.make_packet(pkt, MAXNUM_TXPACKET, 1 + i%4, param[0],
+                                 &param[1], 2) :
+            protocol.make_packet(pkt, MAXNUM_TXPACKET, 1 + i%4, INST_STATUS,
+                                 param, 3);
+        
+        // Noise between packets or a wrong byte inside one
+        if (prob(gen) < errors) {
+            if (prob(gen) < 0.5) {
+                int k = 1 + byte(gen)%8;
+                for (int j = 0; j < k; ++j) stream.append(char(byte(gen)));
+            }
+            else pkt[byte(gen)%n] ^= 1 << (byte(gen)%8);
+        }
+        stream.append((const char*)pkt, n);
+    }
+    return stream;
+}
+
+/// Parses a recorded byte stream with the same parser used with the servos
+/// and shows the found packets and the parsing speed. The stream is a file
+/// with the raw received bytes, it can be generated with --generate, or a
+/// capture of the servo bus with --capture
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("dxlparse");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Dynamixel status packet parser "
+                                     "benchmark");
+    parser.addHelpOption();
+    parser.addPositionalArgument("stream", "Raw received bytes file.");
+    
+    QCommandLineOption proto({"P", "protocol"}, "Protocol version, 1 or 2.",
+                             "version", "1");
+    QCommandLineOption chunk({"c", "chunk"},
+                             "Bytes added to the parser at once.", "bytes",
+                             "64");
+    QCommandLineOption repeat({"n", "repeat"}, "Times the stream is parsed.",
+                              "n", "10");
+    QCommandLineOption gen({"g", "generate"},
+                           "Writes a stream with this number of packets "
+                           "instead of reading it.", "packets");
+    QCommandLineOption errors({"e", "errors"},
+                              "Glitch probability of the generated packets.",
+                              "p", "0.01");
+    QCommandLineOption seed("seed", "Generator seed.", "n", "1");
+    QCommandLineOption capture("capture", "The stream is a capture file, the "
+                               "bytes received by this port are parsed.",
+                               "port", "0");
+    parser.addOption(proto);
+    parser.addOption(chunk);
+    parser.addOption(repeat);
+    parser.addOption(gen);
+    parser.addOption(errors);
+    parser.addOption(seed);
+    parser.addOption(capture);
+    parser.process(a);
+    
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    const QStringList args = parser.positionalArguments();
+    bool ok[6];
+    int version = parser.value(proto).toInt(&ok[0]);
+    int c = parser.value(chunk).toInt(&ok[1]);
+    int r = parser.value(repeat).toInt(&ok[2]);
+    double e = parser.value(errors).toDouble(&ok[3]);
+    unsigned int s = parser.value(seed).toUInt(&ok[4]);
+    int port = parser.value(capture).toInt(&ok[5]);
+    if (not (ok[0] and ok[1] and ok[2] and ok[3] and ok[4] and ok[5]) or
+        args.size() != 1 or c <= 0 or r <= 0 or e < 0 or e > 1) {
+        err << "Invalid arguments\n";
+        return 1;
+    }
+    
+    dxl_protocol *protocol = dxl_protocol::create(version);
+    if (protocol == NULL) {
+        err << "Unknown protocol " << version << "\n";
+        return 1;
+    }
+    
+    QFile f(args[0]);
+    QByteArray stream;
+    if (parser.isSet(gen)) {
+        stream = generate(*protocol, parser.value(gen).toInt(), e, s);
+        if (not f.open(QIODevice::WriteOnly) or
+            f.write(stream) != stream.size()) {
+            err << "Cannot write " << args[0] << "\n";
+            return 1;
+        }
+    }
+    else if (parser.isSet(capture)) {
+        QVector<dxl_capture_port> ports;
+        QVector<dxl_capture_record> records;
+        if (not dxl_capture::load(args[0], ports, records)) {
+            err << "Cannot read the capture " << args[0] << "\n";
+            return 1;
+        }
+        for (const dxl_capture_record &rec : records)
+            if (rec.port == port and rec.kind == dxl_capture::Rx)
+                stream.append(rec.data);
+    }
+    else {
+        if (not f.open(QIODevice::ReadOnly)) {
+            err << "Cannot read " << args[0] << "\n";
+            return 1;
+        }
+        stream = f.readAll();
+    }
+    
+    const unsigned char *data = (const unsigned char*)stream.constData();
+    dxl_parser p(protocol);
+    dxl_status st;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < r; ++i) {
+        p.clear();
+        
+        // The parser stops taking bytes when it's full of packets
+        for (int j = 0; j < stream.size(); ) {
+            j += p.feed(&data[j], qMin(c, stream.size() - j));
+            while (p.next(st));
+        }
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+    
+    const dxl_parser_stats &stats = p.stats();
+    out << stream.size() << " bytes, " << stats.packets/r << " packets, "
+        << stats.corrupt/r << " corrupt, " << stats.dropped/r
+        << " bytes dropped\n";
+    out << "Parsed in " << elapsed/1000000.0/r << " ms, "
+        << stats.bytes*1000.0/elapsed << " MB/s, "
+        << (stats.packets ? double(elapsed)/stats.packets : 0.0)
+        << " ns/packet\n";
+    
+    delete protocol;
+    return 0;
+}
@@ -0,0 +1,85 @@
+/// @file Tools/workspace/main.cpp Contains the workspace mapping tool
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include "kinematics.h"
+#include "workspacegrid.h"
+
+/// Maps the robot workspace with the controller kinematics and angle limits,
+/// it replaces the Matlab calcWorkspace script. The reachable points are 
+/// stored with the "Punts Valids.txt" format and the grid is stored with the
+/// format loaded by the controller (workspace.grid)
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("workspace");
+    
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Delta robot workspace mapping");
+    parser.addHelpOption();
+    
+    // Defaults are the ones used by the controller
+    QCommandLineOption res({"r", "resolution"}, "Grid step in cm.", "cm", "0.2");
+    QCommandLineOption xy("xy", "Maximum X and Y absolute value in cm.", "cm",
+                          "12");
+    QCommandLineOption zMin("zmin", "Minimum Z in cm.", "cm", "0");
+    QCommandLineOption zMax("zmax", "Maximum Z in cm.", "cm", "24");
+    QCommandLineOption threads({"j", "threads"}, 
+                               "Worker threads, 0 uses all the cores.", "n",
+                               "0");
+    QCommandLineOption grid({"g", "grid"}, "Binary grid output file.", "file",
+                            "workspace.grid");
+    QCommandLineOption points({"p", "points"}, "Text points output file.", 
+                              "file");
+    parser.addOption(res);
+    parser.addOption(xy);
+    parser.addOption(zMin);
+    parser.addOption(zMax);
+    parser.addOption(threads);
+    parser.addOption(grid);
+    parser.addOption(points);
+    parser.process(a);
+    
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    
+    bool ok[5];
+    double r = parser.value(res).toDouble(&ok[0]);
+    double xyMax = parser.value(xy).toDouble(&ok[1]);
+    double z0 = parser.value(zMin).toDouble(&ok[2]);
+    double z1 = parser.value(zMax).toDouble(&ok[3]);
+    int n = parser.value(threads).toInt(&ok[4]);
+    if (not (ok[0] and ok[1] and ok[2] and ok[3] and ok[4]) or r <= 0 or
+        xyMax <= 0 or z1 <= z0 or n < 0) {
+        err << "Invalid arguments\n";
+        return 1;
+    }
+    if (n > 0) QThreadPool::globalInstance()->setMaxThreadCount(n);
+    
+    Kinematics k;
+    WorkspaceGrid g;
+    QVector<uchar> nodes;
+    QElapsedTimer timer;
+    timer.start();
+    g.build(k, xyMax, z0, z1, r, parser.isSet(points) ? &nodes : NULL);
+    qint64 elapsed = timer.elapsed();
+    
+    qint64 voxels = qint64(g.width())*g.width()*g.height();
+    out << "Grid " << g.width() << "x" << g.width() << "x" << g.height() 
+        << " (" << voxels << " voxels) built in " << elapsed << " ms with "
+        << QThreadPool::globalInstance()->maxThreadCount() << " threads, "
+        << "vector code: " << Kinematics::simd() << "\n";
+    
+    if (not g.save(parser.value(grid), k)) {
+        err << "Cannot write " << parser.value(grid) << "\n";
+        return 1;
+    }
+    if (parser.isSet(points) and not g.savePoints(parser.value(points), nodes)) {
+        err << "Cannot write " << parser.value(points) << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,24 @@
+# Command line tool that maps the robot workspace with the same kinematics and
+# limits used by the controller
+QT += core concurrent
+QT -= gui
+
+TARGET = workspace
+TEMPLATE = app
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+# Same vector instructions option as the controller
+avx2 {
+    *-g++*|*clang*: QMAKE_CXXFLAGS += -mavx2
+    win32-msvc*: QMAKE_CXXFLAGS += /arch:AVX2
+}
+
+INCLUDEPATH += ../..
+
+SOURCES += main.cpp \
+    ../../kinematics.cpp \
+    ../../workspacegrid.cpp
+
+HEADERS += ../../kinematics.h \
+    ../../workspacegrid.h
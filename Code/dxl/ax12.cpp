@@ -2,13 +2,134 @@
 /// Contains the AX12 class implementation
 #include "ax12.h"
 
+AX12::Transaction::Transaction(QVector<AX12> &A) :
+    _A(A),
+    _staged(A.size(), QVector<short>(TableSize, -1))
+{
+    
+}
+
+void AX12::Transaction::clear()
+{
+    for (QVector<short> &s : _staged) s.fill(-1);
+}
+
+bool AX12::Transaction::commit()
+{
+    // Every servo range, the gaps are filled with the shadow table or read
+    dynamixel *dxl = NULL;
+    QVector<int> index, first;
+    QVector< QVector<int> > data;
+    for (int i = 0; i < _A.size() and i < _staged.size(); ++i) {
+        AX12 &a = _A[i];
+        const QVector<short> &s = _staged[i];
+        if (a._ID < 0 or a._dxl == NULL) continue;
+        
+        int lo = 0, hi = TableSize - 1;
+        while (lo < TableSize and s[lo] < 0) ++lo;
+        while (hi >= lo and s[hi] < 0) --hi;
+        if (lo > hi) continue;
+        
+        bool changed = false;
+        QVector<int> d(hi - lo + 1);
+        for (int j = lo; j <= hi; ++j) {
+            if (not isWritable(j)) {
+                clear();
+                return false;
+            }
+            
+            if (s[j] >= 0) {
+                d[j - lo] = s[j];
+                if (a._table[j] != s[j]) changed = true;
+                continue;
+            }
+            
+            if (a._table[j] < 0) {
+                int v = a._dxl->read_byte(a._ID, j);
+                if (a._dxl->get_comm_result() != COMM_RXSUCCESS) {
+                    clear();
+                    return false;
+                }
+                a.cache(j, 1, v);
+            }
+            d[j - lo] = a._table[j];
+        }
+        if (not changed) continue;
+        
+        Q_ASSERT(dxl == NULL or dxl == a._dxl);
+        dxl = a._dxl;
+        index.push_back(i);
+        first.push_back(lo);
+        data.push_back(d);
+    }
+    clear();
+    if (dxl == NULL) return true;
+    
+    // The servos answer the REG_WRITE, so every write is checked before
+    // executing them
+    for (int k = 0; k < index.size(); ++k) {
+        AX12 &a = _A[index[k]];
+        dxl->reg_write(a._ID, first[k], data[k]);
+        if (dxl->get_comm_result() != COMM_RXSUCCESS) {
+            for (int i : index) _A[i].invalidate();
+            return false;
+        }
+    }
+    
+    dxl->action();
+    if (dxl->get_comm_result() != COMM_RXSUCCESS) {
+        for (int i : index) _A[i].invalidate();
+        return false;
+    }
+    
+    for (int k = 0; k < index.size(); ++k) {
+        AX12 &a = _A[index[k]];
+        for (int j = 0; j < data[k].size(); ++j) {
+            a.cache(first[k] + j, 1, data[k][j]);
+        }
+    }
+    return true;
+}
+
+bool AX12::Transaction::isEmpty() const
+{
+    for (const QVector<short> &s : _staged) {
+        for (short b : s) if (b >= 0) return false;
+    }
+    return true;
+}
+
+void AX12::Transaction::setGoalPosition(int servo, double goal)
+{
+    int pos = _A[servo].toPosition(goal);
+    if (pos >= 0) writeWord(servo, RAM::GoalPosition, pos);
+}
+
+void AX12::Transaction::setSpeed(int servo, double speed)
+{
+    writeWord(servo, RAM::MovingSpeed, _A[servo].toSpeed(speed));
+}
+
+void AX12::Transaction::writeByte(int servo, int address, int value)
+{
+    Q_ASSERT(servo >= 0 and servo < _staged.size());
+    if (address < 0 or address >= TableSize) return;
+    _staged[servo][address] = value & 0xFF;
+}
+
+void AX12::Transaction::writeWord(int servo, int address, int value)
+{
+    writeByte(servo, address, LOBYTE(value));
+    writeByte(servo, address + 1, HIBYTE(value));
+}
+
 AX12::AX12() :
     _dxl(NULL),
     _ID(-1),
     _mode(true),
     _rads(false)
 {
-    
+    invalidate();
 }
 
 AX12::AX12(dynamixel *dxl, int ID) : 
@@ -17,6 +138,7 @@ AX12::AX12(dynamixel *dxl, int ID) :
    _mode(true),
    _rads(false)
 {
+    invalidate();
     if (_ID < 0 or _dxl == NULL) return;
     dxl->write_byte(_ID, RAM::TorqueEnable, true);
 }
@@ -27,7 +149,7 @@ AX12::AX12(const AX12 &a) :
     _mode(a._mode),
     _rads(a._rads)
 {
-    
+    for (int i = 0; i < TableSize; ++i) _table[i] = a._table[i];
 }
 
 AX12::~AX12()
@@ -62,8 +184,40 @@ double AX12::getCurrentPos()
     int pos = _dxl->read_word(_ID, RAM::PresentPosition);
     if (_dxl->get_comm_result() != COMM_RXSUCCESS) return -1;
     
-    if (_rads) return double((pos/1023.0)*(5.0*M_PI)/3.0);
-    return double((pos/1023.0)*300);
+    return toAngle(pos);
+}
+
+int AX12::getCurrentPos(QVector<AX12> &A, QVector<double> &pos, 
+                        QVector<double> &time)
+{
+    pos.fill(0, A.size());
+    time.fill(0.0, A.size());
+    
+    // Only servos with a valid ID are read
+    dynamixel *dxl = NULL;
+    QVector<int> index, ID;
+    for (int i = 0; i < A.size(); ++i) {
+        if (A[i]._ID < 0 or A[i]._dxl == NULL) continue;
+        Q_ASSERT(dxl == NULL or dxl == A[i]._dxl);
+        dxl = A[i]._dxl;
+        index.push_back(i);
+        ID.push_back(A[i]._ID);
+    }
+    if (dxl == NULL) return 0;
+    
+    QVector<int> value;
+    QVector<double> t;
+    int read = dxl->bulk_read_word(ID, RAM::PresentPosition, value, t);
+    
+    for (int i = 0; i < index.size(); ++i) {
+        int j = index[i];
+        pos[j] = value[i] < 0 ? -1 : A[j].toAngle(value[i]);
+        time[j] = t[i];
+        
+        // A servo that doesn't answer could have been reset
+        if (value[i] < 0) A[j].invalidate();
+    }
+    return read;
 }
 
 int AX12::getCurrentTemp()
@@ -92,30 +246,203 @@ double AX12::getCurrentVoltage()
     return double(voltage/10.0);
 }
 
-void AX12::setComplianceSlope(uchar ccw, uchar cw)
+void AX12::invalidate()
 {
-    if (_ID < 0 or _dxl == NULL) return;
-    _dxl->write_byte(_ID, RAM::CCWComplianceMargin, ccw);
-    _dxl->write_byte(_ID, RAM::CWComplianceMargin, cw);
+    for (short &t : _table) t = -1;
 }
 
-void AX12::setGoalPosition(double goal)
+bool AX12::isCached(int address, int length, int value) const
 {
-    if (_ID < 0 or _dxl == NULL) return;
+    if (address < 0 or address + length > TableSize) return false;
+    for (int i = 0; i < length; ++i) {
+        if (_table[address + i] != ((value >> 8*i) & 0xFF)) return false;
+    }
+    return true;
+}
+
+void AX12::cache(int address, int length, int value)
+{
+    if (address < 0 or address + length > TableSize) return;
+    for (int i = 0; i < length; ++i) {
+        _table[address + i] = (value >> 8*i) & 0xFF;
+    }
+}
+
+void AX12::uncache(int address, int length)
+{
+    if (address < 0 or address + length > TableSize) return;
+    for (int i = 0; i < length; ++i) _table[address + i] = -1;
+}
+
+void AX12::writeByte(int address, int value)
+{
+    if (isCached(address, 1, value)) return;
+    _dxl->write_byte(_ID, address, value);
+    
+    if (_dxl->get_comm_result() == COMM_RXSUCCESS) cache(address, 1, value);
+    else uncache(address, 1);
+}
+
+void AX12::writeWord(int address, int value)
+{
+    if (isCached(address, 2, value)) return;
+    _dxl->write_word(_ID, address, value);
+    
+    if (_dxl->get_comm_result() == COMM_RXSUCCESS) cache(address, 2, value);
+    else uncache(address, 2);
+}
+
+void AX12::syncWrite(QVector<AX12> &A, int address, int length, 
+                     const QVector<int> &value, bool force)
+{
+    Q_ASSERT(value.size() == A.size());
+    
+    // Only the servos whose register changes are written
+    dynamixel *dxl = NULL;
+    QVector<int> index, ID, data;
+    for (int i = 0; i < A.size(); ++i) {
+        const AX12 &a = A[i];
+        if (a._ID < 0 or a._dxl == NULL or value[i] < 0) continue;
+        if (not force and a.isCached(address, length, value[i])) continue;
+        
+        Q_ASSERT(dxl == NULL or dxl == a._dxl);
+        dxl = a._dxl;
+        index.push_back(i);
+        ID.push_back(a._ID);
+        for (int j = 0; j < length; ++j) {
+            data.push_back((value[i] >> 8*j) & 0xFF);
+        }
+    }
+    if (dxl == NULL) return;
+    
+    dxl->sync_write(ID, address, length, data);
+    
+    // The servos don't answer a SYNC_WRITE, the values are cached if the
+    // packet has been sent
+    bool sent = dxl->get_comm_result() == COMM_RXSUCCESS;
+    for (int i : index) {
+        if (sent) A[i].cache(address, length, value[i]);
+        else A[i].uncache(address, length);
+    }
+}
+
+bool AX12::isWritable(int address)
+{
+    // EEPROM from the ID to the alarm shutdown (10 is reserved) and RAM up 
+    // to the torque limit, the lock and the punch
+    if (address >= ROM::ID and address <= ROM::AlarmShutdown) {
+        return address != 10;
+    }
+    if (address >= RAM::TorqueEnable and address < RAM::PresentPosition) {
+        return true;
+    }
+    return address >= RAM::Lock and address < TableSize;
+}
+
+double AX12::toAngle(int pos)
+{
+    if (_rads) return double((pos/1023.0)*(5.0*M_PI)/3.0);
+    return double((pos/1023.0)*300);
+}
+
+int AX12::toPosition(double goal)
+{
+    if (qIsNaN(goal)) return -1;
     
     // Conversion to radians if radians mode
     if (_rads) goal *= 180/M_PI;
     
     if (goal > 300.0) goal = 300.0;
     else if (goal < 0) goal = 0;
-    _dxl->write_word(_ID, RAM::GoalPosition, int((goal/300.0)*1023));
+    return int((goal/300.0)*1023);
+}
+
+int AX12::toSpeed(double speed)
+{
+    if (speed > 100.0) speed = 100.0;
+    if (_mode) {
+        if (speed < 0.0) speed = 0.0;
+        if (speed == 100.0) return 0;
+        return int((speed/100.0) * 1024.0);
+    }
+    
+    if (speed < -100.0) speed = -100.0;   
+    return int(((speed + 100)/100.0) * 1024);
+}
+
+void AX12::setComplianceSlope(uchar ccw, uchar cw)
+{
+    if (_ID < 0 or _dxl == NULL) return;
+    writeByte(RAM::CCWComplianceMargin, ccw);
+    writeByte(RAM::CWComplianceMargin, cw);
+}
+
+void AX12::setComplianceSlope(QVector<AX12> &A, uchar ccw, uchar cw)
+{
+    // Both registers are contiguous, CW first
+    QVector<int> value(A.size(), MAKEWORD(cw, ccw));
+    syncWrite(A, RAM::CWComplianceMargin, 2, value);
+}
+
+void AX12::setGoalPosition(double goal)
+{
+    if (_ID < 0 or _dxl == NULL) return;
+    
+    int pos = toPosition(goal);
+    if (pos >= 0) writeWord(RAM::GoalPosition, pos);
+}
+
+void AX12::setGoalPosition(QVector<AX12> &A, const QVector<double> &goal)
+{
+    QVector<int> value(A.size(), -1);
+    for (int i = 0; i < A.size() and i < goal.size(); ++i) {
+        value[i] = A[i].toPosition(goal[i]);
+    }
+    syncWrite(A, RAM::GoalPosition, 2, value);
+}
+
+void AX12::moveTo(QVector<AX12> &A, const QVector<double> &goal, 
+                  const QVector<double> &ratio, double speed)
+{
+    // MovingSpeed 0 means no speed control, the maximum one is used instead
+    // and it's never scaled down to 0. The servos whose goal or speed has
+    // changed are written, the others are skipped by syncWrite()
+    int n = A.size();
+    QVector<int> value(n, -1);
+    for (int i = 0; i < n and i < goal.size(); ++i) {
+        int pos = A[i].toPosition(goal[i]);
+        if (pos < 0) continue;
+        
+        int base = A[i].toSpeed(speed);
+        if (base == 0) base = 1023;
+        
+        double r = i < ratio.size() and ratio[i] >= 0 ? qMin(ratio[i], 1.0) 
+                                                       : 1.0;
+        int vel = qMax(1, qRound(base*r));
+        value[i] = pos | (vel << 16);
+    }
+    syncWrite(A, RAM::GoalPosition, 4, value);
 }
 
 void AX12::setID(int ID)
 {
+    if (ID != _ID) invalidate();
     _ID = ID;
     if (_ID < 0 or _dxl == NULL) return;
-    _dxl->write_byte(_ID, RAM::TorqueEnable, true);
+    
+    // Always sent, the servo disables the torque on an alarm
+    uncache(RAM::TorqueEnable, 1);
+    writeByte(RAM::TorqueEnable, true);
+}
+
+void AX12::setID(QVector<AX12> &A, const QVector<int> &ID)
+{
+    Q_ASSERT(ID.size() == A.size());
+    for (int i = 0; i < A.size(); ++i) {
+        if (ID[i] != A[i]._ID) A[i].invalidate();
+        A[i]._ID = ID[i];
+    }
+    setTorque(A, true);
 }
 
 void AX12::setJointMode(bool mode)
@@ -123,12 +450,12 @@ void AX12::setJointMode(bool mode)
     if (_ID < 0 or _dxl == NULL) return;
     _mode = mode;
     if (_mode) {
-        _dxl->write_word(_ID, ROM::CWAngleLimit, 0);
-        _dxl->write_word(_ID, ROM::CCWAngleLimit, 1023);
+        writeWord(ROM::CWAngleLimit, 0);
+        writeWord(ROM::CCWAngleLimit, 1023);
     }
     else {
-        _dxl->write_word(_ID, ROM::CWAngleLimit, 0);
-        _dxl->write_word(_ID, ROM::CCWAngleLimit, 0);
+        writeWord(ROM::CWAngleLimit, 0);
+        writeWord(ROM::CCWAngleLimit, 0);
     }
 }
 
@@ -150,27 +477,28 @@ void AX12::setMinMax(double min, double max)
     min = (min/300)*1023;
     max = (max/300)*1023;
     
-    _dxl->write_word(_ID, ROM::CWAngleLimit, int (min));
-    _dxl->write_word(_ID, ROM::CCWAngleLimit, int (max));
+    writeWord(ROM::CWAngleLimit, int (min));
+    writeWord(ROM::CCWAngleLimit, int (max));
 }
 
 void AX12::setSpeed(double speed)
 {
     if (_ID < 0 or _dxl == NULL) return;
-    if (speed > 100.0) speed = 100.0;
-    if (_mode) {
-        if (speed < 0.0) speed = 0.0;
-        
-        int byte = int((speed/100.0) * 1024.0);
-        if (speed == 100.0) byte = 0;
-        _dxl->write_byte(_ID, RAM::MovingSpeed, byte);        
-    }
-    else {
-        if (speed < -100.0) speed = -100.0;   
-        
-        int byte = int(((speed + 100)/100.0) * 1024);
-        _dxl->write_byte(_ID, RAM::MovingSpeed, byte);
-    }
+    
+    // MovingSpeed is a word, writing only its low byte made some speeds 
+    // wrap to the maximum
+    writeWord(RAM::MovingSpeed, toSpeed(speed));
+}
 
+void AX12::setSpeed(QVector<AX12> &A, double speed)
+{
+    QVector<int> value(A.size());
+    for (int i = 0; i < A.size(); ++i) value[i] = A[i].toSpeed(speed);
+    syncWrite(A, RAM::MovingSpeed, 2, value);
 }
 
+void AX12::setTorque(QVector<AX12> &A, bool enable)
+{
+    QVector<int> value(A.size(), enable ? 1 : 0);
+    syncWrite(A, RAM::TorqueEnable, 1, value, true);
+}
@@ -15,11 +15,19 @@
 
 
 /// @brief The AX12 class is used to control AX-12 motors from Dynamixel
+/// 
+/// Every AX12 keeps a shadow copy of the control table values it has 
+/// written, writes that wouldn't change anything aren't sent. The static
+/// setters write the same registers of several servos with a single 
+/// SYNC_WRITE instruction.
 class AX12
 {
     
 private: 
     
+    /// Size of the control table
+    static const int TableSize = 50;
+    
     /// Contains the dynamixel comunication
     dynamixel *_dxl;
     
@@ -32,6 +40,50 @@ private:
     /// True if the angle is returned in radians
     bool _rads;
     
+    /// Last value written to every control table byte, -1 if unknown
+    short _table[TableSize];
+    
+    /// Returns true if the shadow table already contains the value
+    /// @param address First address of the register
+    /// @param length Register length in bytes
+    /// @param value Register value
+    bool isCached(int address, int length, int value) const;
+    
+    /// Stores a written value in the shadow table
+    void cache(int address, int length, int value);
+    
+    /// Removes a register from the shadow table
+    void uncache(int address, int length);
+    
+    /// Writes a byte if it's not already in the servo
+    void writeByte(int address, int value);
+    
+    /// Writes a word if it's not already in the servo
+    void writeWord(int address, int value);
+    
+    /// Writes a register of all the servos with a single SYNC_WRITE, only 
+    /// the servos whose register would change are included
+    /// @param A Contains the servos, all of them must share the dynamixel
+    /// @param address First address of the register
+    /// @param length Register length in bytes
+    /// @param value Contains the value of every servo, -1 to skip it
+    /// @param force Writes even if the values are already cached
+    static void syncWrite(QVector<AX12> &A, int address, int length, 
+                          const QVector<int> &value, bool force = false);
+    
+    /// Converts a position read from the servo to degrees or radians
+    double toAngle(int pos);
+    
+    /// Converts an angle in degrees or radians to a servo position, -1 if
+    /// it's not a number
+    int toPosition(double goal);
+    
+    /// Converts a speed in % to the MovingSpeed register value
+    int toSpeed(double speed);
+    
+    /// Returns true if the address can be written
+    static bool isWritable(int address);
+    
 public:
     
     /// Contains all the EEPROM directions enumeration
@@ -77,6 +129,67 @@ public:
         
     };   
     
+    /// The Transaction's class stages register writes of several servos, 
+    /// every servo receives them with a single REG_WRITE and all of them 
+    /// are executed at the same time with a broadcast ACTION. The staged 
+    /// registers of a servo don't need to be contiguous, the gaps are 
+    /// filled with the values in the shadow table.
+    class Transaction
+    {
+    public:
+        
+        /// Initialization constructor
+        /// @param A Contains the servos, all of them must share the 
+        /// dynamixel interface and must outlive the transaction
+        Transaction(QVector<AX12> &A);
+        
+        /// Discards all the staged writes
+        void clear();
+        
+        /// Sends the staged writes and executes them, nothing is sent to
+        /// the servos that already have all the values. The staged writes
+        /// are cleared
+        /// @return False if a servo didn't acknowledge its write, then no
+        /// ACTION is sent and the other servos keep their registered write
+        /// until the next one. Also false if the registers of a servo span
+        /// read only addresses and then nothing is sent
+        bool commit();
+        
+        /// Returns true if nothing is staged
+        bool isEmpty() const;
+        
+        /// Stages a goal position
+        /// @param servo Servo index
+        /// @param goal Position in degrees or radians
+        void setGoalPosition(int servo, double goal);
+        
+        /// Stages a speed
+        /// @param servo Servo index
+        /// @param speed Speed in %
+        void setSpeed(int servo, double speed);
+        
+        /// Stages a byte write
+        /// @param servo Servo index
+        /// @param address Register address
+        /// @param value Byte value
+        void writeByte(int servo, int address, int value);
+        
+        /// Stages a word write
+        /// @param servo Servo index
+        /// @param address Register address
+        /// @param value Word value
+        void writeWord(int servo, int address, int value);
+        
+    private:
+        
+        /// Contains the servos
+        QVector<AX12> &_A;
+        
+        /// Staged value of every control table byte of every servo, -1 if
+        /// it's not staged
+        QVector< QVector<short> > _staged;
+    };
+    
     /// Default constructor
     AX12();
     
@@ -100,6 +213,15 @@ public:
     /// Returns the current position from 0º to 300º
     double getCurrentPos();
     
+    /// Reads the current position of all the servos in a single bus 
+    /// transaction, all of them must share the same dynamixel interface
+    /// @param A Contains the servos to read
+    /// @param pos Stores the positions from 0º to 300º, -1 if not read
+    /// @param time Stores the time in ms when every position was received
+    /// @return Number of positions correctly read
+    static int getCurrentPos(QVector<AX12> &A, QVector<double> &pos,
+                             QVector<double> &time);
+    
     /// Returns the current Temperature in Celsius
     int getCurrentTemp();
     
@@ -113,11 +235,19 @@ public:
     /// To get the current ID
     inline int getID() { return _ID; }
     
+    /// Forgets the shadow copy of the control table, it must be called if
+    /// the servo could have been reset or written by someone else
+    void invalidate();
+    
+    
     /// Sets the compliance slope
     /// @param ccw Counter Clock Wise Compliance Slope
     /// @param cw Clock Wise Compliance Slope
     void setComplianceSlope(uchar ccw, uchar cw);
     
+    /// Sets the compliance slope of all the servos with a single packet
+    static void setComplianceSlope(QVector<AX12> &A, uchar ccw, uchar cw);
+    
     /// Sets the dynamixel interface
     /// @param dxl Pointer to the dynamixel control class
     inline void setDxl(dynamixel *dxl) { _dxl = dxl; }
@@ -127,10 +257,35 @@ public:
     /// used wheel mode
     void setGoalPosition(double goal);
     
+    /// Sets the goal position of all the servos with a single packet, the
+    /// servos that already have it aren't written
+    /// @param A Contains the servos
+    /// @param goal Contains the position of every servo, NaN to skip it
+    static void setGoalPosition(QVector<AX12> &A, const QVector<double> &goal);
+    
+    /// Moves all the servos with a fraction of the speed each, so the ones
+    /// with a shorter move arrive at the same time. The goal position and
+    /// the speed (registers 30 to 33) are written with a single packet,
+    /// nothing is sent to the servos that already have both
+    /// @pre The servos are in joint mode
+    /// @param A Contains the servos
+    /// @param goal Contains the goal of every servo, NaN to skip it
+    /// @param ratio Contains the fraction of the speed of every servo, 
+    /// negative or missing for the whole speed
+    /// @param speed Speed of the servo with the longest move from 0% to 100%
+    static void moveTo(QVector<AX12> &A, const QVector<double> &goal, 
+                       const QVector<double> &ratio, double speed);
+    
     /// To set a new ID
     /// @param ID the new ID
     void setID(int ID);
     
+    /// Sets the ID of all the servos and enables their torque with a single
+    /// packet
+    /// @param A Contains the servos
+    /// @param ID Contains the new IDs
+    static void setID(QVector<AX12> &A, const QVector<int> &ID);
+    
     /// To set Joint/Wheel mode
     /// @param mode True if Joint and false if Wheel mode
     void setJointMode(bool mode);
@@ -148,6 +303,13 @@ public:
     /// to 100% if wheel mode
     void setSpeed(double speed);
     
+    /// Sets the speed of all the servos with a single packet
+    static void setSpeed(QVector<AX12> &A, double speed);
+    
+    /// Enables or disables the torque of all the servos with a single 
+    /// packet, it's always sent because the servos disable it on an alarm
+    static void setTorque(QVector<AX12> &A, bool enable);
+    
 };
 
 #endif // AX12_H
@@ -0,0 +1,88 @@
+/// @file dxl_bus.cpp Contains the dxl_bus class implementation
+#include "dxl_bus.h"
+
+QMutex dxl_bus::gPoolMutex;
+QHash<QString, dxl_bus*> dxl_bus::gPool;
+
+dxl_bus* dxl_bus::attach(const QString &port, int baud, int protocol)
+{
+    gPoolMutex.lock();
+    dxl_bus *bus = gPool.value(port, NULL);
+    if (bus == NULL) {
+        bus = new dxl_bus(port);
+        gPool.insert(port, bus);
+    }
+    ++bus->_refs;
+    gPoolMutex.unlock();
+    
+    // Opened with the bus locked so it doesn't change under another client,
+    // also retried if a previous one couldn't open it
+    dynamixel *dxl = bus->lock(Config);
+    if (not dxl->isOpen()) {
+        dxl->set_protocol(protocol);
+        dxl->initialize(port, baud);
+    }
+    bus->unlock();
+    
+    return bus;
+}
+
+void dxl_bus::detach(dxl_bus *bus)
+{
+    if (bus == NULL) return;
+    
+    QMutexLocker pool(&gPoolMutex);
+    if (--bus->_refs > 0) return;
+    
+    gPool.remove(bus->_port);
+    delete bus;
+}
+
+quint64 dxl_bus::next() const
+{
+    // The oldest client once it has been passed over enough times, else the
+    // oldest one with the highest priority
+    const waiter *best = &_waiting.first();
+    for (const waiter &w : _waiting) {
+        if (_overtakes >= MaxOvertakes) {
+            if (w.ticket < best->ticket) best = &w;
+        }
+        else if (w.priority < best->priority or
+                 (w.priority == best->priority and w.ticket < best->ticket)) {
+            best = &w;
+        }
+    }
+    return best->ticket;
+}
+
+dynamixel* dxl_bus::lock(Priority priority)
+{
+    QMutexLocker m(&_mutex);
+    
+    waiter me = { _ticket++, int(priority) };
+    _waiting.append(me);
+    while (_busy or next() != me.ticket) _cond.wait(&_mutex);
+    
+    // Counts if an older client is still waiting
+    quint64 oldest = me.ticket;
+    int index = 0;
+    for (int i = 0; i < _waiting.size(); ++i) {
+        if (_waiting[i].ticket == me.ticket) index = i;
+        oldest = qMin(oldest, _waiting[i].ticket);
+    }
+    _waiting.removeAt(index);
+    _overtakes = (oldest < me.ticket) ? _overtakes + 1 : 0;
+    
+    _busy = true;
+    return &_dxl;
+}
+
+void dxl_bus::unlock()
+{
+    QMutexLocker m(&_mutex);
+    _busy = false;
+    
+    // Every waiting client checks if it's the next one, there are only a
+    // few of them
+    if (not _waiting.isEmpty()) _cond.wakeAll();
+}
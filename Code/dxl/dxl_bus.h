@@ -0,0 +1,146 @@
+/// @file dxl_bus.h Contains the dxl_bus class declaration
+#ifndef _DYNAMIXEL_BUS_HEADER
+#define _DYNAMIXEL_BUS_HEADER
+
+#include "dynamixel.h"
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+/// Shares a serial port between several threads. There's a single bus for
+/// every port name, it owns the dynamixel interface and gives it to one
+/// client at a time. The waiting clients sleep and the bus is given by
+/// priority, in arrival order within the same priority. A waiting client
+/// is passed over a few times at most, so a busy control loop can't starve
+/// a scan.
+///
+/// The dynamixel results (comm result, status packet) belong to the client
+/// that holds the bus, so it must be kept locked from the instruction until
+/// the results are read. dxl_bus_locker does it for a scope.
+class dxl_bus {
+public:
+    
+    /// Priorities of the clients, the first ones are served before
+    enum Priority {
+        Control,        ///< Control loop traffic
+        Config,         ///< Configuration changes
+        Diagnostic,     ///< Telemetry and diagnostics
+        Scan,           ///< Servo discovery
+        PriorityNum
+    };
+    
+    /// Returns the bus of a port, it's opened by the first client with its
+    /// baud rate and protocol. The other clients get the same bus with the
+    /// current settings
+    /// @param port Port name, with the optional backend prefix
+    /// @param baud Baud rate if the port is opened
+    /// @param protocol Protocol version if the port is opened
+    static dxl_bus* attach(const QString &port, int baud, int protocol);
+    
+    /// Releases a bus returned by attach(), the last client closes the port
+    /// @pre The bus isn't locked by the client
+    static void detach(dxl_bus *bus);
+    
+    /// Blocks until the bus is free and no client is before this one
+    /// @param priority Client priority
+    /// @return The dynamixel interface, valid until unlock()
+    dynamixel* lock(Priority priority);
+    
+    /// Gives the bus to the next client
+    void unlock();
+    
+    /// Returns the dynamixel interface without locking the bus, it can only
+    /// be used while the bus is locked
+    inline dynamixel* device() { return &_dxl; }
+    
+    /// Returns the port name
+    inline QString port() const { return _port; }
+    
+private:
+    
+    /// A client waiting for the bus
+    struct waiter {
+        quint64 ticket;     ///< Arrival order
+        int priority;       ///< Client priority
+    };
+    
+    /// Times a waiting client can be passed over by newer clients
+    static const int MaxOvertakes = 4;
+    
+    /// Dynamixel interface of the port
+    dynamixel _dxl;
+    
+    /// Port name
+    QString _port;
+    
+    /// Protects the bus state
+    QMutex _mutex;
+    
+    /// Wakes the waiting clients when the bus is released
+    QWaitCondition _cond;
+    
+    /// True while a client has the bus
+    bool _busy = false;
+    
+    /// Clients waiting for the bus
+    QList<waiter> _waiting;
+    
+    /// Next arrival ticket
+    quint64 _ticket = 0;
+    
+    /// Clients served before the oldest waiting one
+    int _overtakes = 0;
+    
+    /// Clients attached, changed with the pool mutex
+    int _refs = 0;
+    
+    /// Protects the pool
+    static QMutex gPoolMutex;
+    
+    /// Buses by port name
+    static QHash<QString, dxl_bus*> gPool;
+    
+    /// Initialization constructor
+    /// @param port Port name
+    explicit dxl_bus(const QString &port) : _port(port) {}
+    
+    /// Returns the ticket of the client that must be served next
+    /// @pre The bus mutex is locked and there are waiting clients
+    quint64 next() const;
+    
+    Q_DISABLE_COPY(dxl_bus)
+};
+
+/// Locks a bus for a scope, like QMutexLocker
+class dxl_bus_locker {
+public:
+    
+    /// Blocks until the bus is given to this client
+    /// @param bus Bus to lock
+    /// @param priority Client priority
+    dxl_bus_locker(dxl_bus *bus, dxl_bus::Priority priority) :
+        _bus(bus),
+        _dxl(bus->lock(priority))
+    {
+        
+    }
+    
+    /// Releases the bus
+    ~dxl_bus_locker() { _bus->unlock(); }
+    
+    /// Returns the dynamixel interface
+    inline dynamixel* get() { return _dxl; }
+    
+    /// Accesses the dynamixel interface
+    inline dynamixel* operator->() { return _dxl; }
+    
+private:
+    dxl_bus *_bus;
+    dynamixel *_dxl;
+    
+    Q_DISABLE_COPY(dxl_bus_locker)
+};
+
+#endif
@@ -0,0 +1,273 @@
+/// @file dxl_capture.cpp Contains the dxl_capture class implementation
+#include "dxl_capture.h"
+#include "dxl_clock.h"
+
+#include <QThread>
+#include <QWaitCondition>
+
+#include <algorithm>
+#include <cstring>
+
+/// Capture file identifier
+#define CAPTURE_MAGIC       "DXLC"
+
+/// Capture file format version
+#define CAPTURE_VERSION     (1)
+
+/// Writes the records of the ports to the capture file every 
+/// dxl_capture::FlushTime
+class dxl_capture_writer : public QThread {
+public:
+    
+    /// Stops the thread after writing the pending records
+    void finish()
+    {
+        _mutex.lock();
+        _stop = true;
+        _cond.wakeOne();
+        _mutex.unlock();
+        wait();
+    }
+    
+protected:
+    
+    void run()
+    {
+        QMutexLocker m(&_mutex);
+        while (not _stop) {
+            _cond.wait(&_mutex, dxl_capture::FlushTime/1000000);
+            m.unlock();
+            dxl_capture::flush();
+            m.relock();
+        }
+    }
+    
+private:
+    
+    QMutex _mutex;          ///< Protects the stop flag
+    QWaitCondition _cond;   ///< Wakes the thread to stop it
+    bool _stop = false;     ///< True when the thread must end
+};
+
+QMutex dxl_capture::gMutex;
+QFile dxl_capture::gFile;
+QByteArray dxl_capture::gOut;
+qint64 dxl_capture::gLast = 0;
+dxl_capture::buffer dxl_capture::gBuffers[dxl_capture::MaxPorts];
+QAtomicInt dxl_capture::gPorts(0);
+QAtomicInt dxl_capture::gActive(0);
+QAtomicInt dxl_capture::gGeneration(0);
+dxl_capture_writer *dxl_capture::gWriter = NULL;
+
+/// A block of a port buffer before it's encoded
+struct dxl_capture_block {
+    qint64 key;         ///< Order, never before the previous port block
+    qint64 ns;          ///< Monotonic time in ns
+    int port;           ///< Port index
+    int kind;           ///< dxl_capture::Kind
+    const char *data;   ///< Bytes
+    int n;              ///< Number of bytes
+    
+    /// Orders the blocks by time
+    bool operator<(const dxl_capture_block &b) const { return key < b.key; }
+};
+
+/// Appends an unsigned LEB128 varint
+static inline void put_varint(QByteArray &buf, quint64 value)
+{
+    while (value >= 0x80) {
+        buf.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buf.append(char(value));
+}
+
+/// Reads an unsigned LEB128 varint
+/// @return False if the data ends before the varint
+static inline bool get_varint(const QByteArray &buf, int &pos, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; pos < buf.size() and shift < 64; shift += 7) {
+        uchar b = uchar(buf[pos++]);
+        value |= quint64(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool dxl_capture::start(const QString &file)
+{
+    stop();
+    
+    QMutexLocker m(&gMutex);
+    gFile.setFileName(file);
+    if (not gFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    
+    gOut.clear();
+    gOut.append(CAPTURE_MAGIC);
+    gOut.append(char(CAPTURE_VERSION));
+    gLast = dxl_clock::ns();
+    
+    for (buffer &b : gBuffers) {
+        QMutexLocker l(&b.mutex);
+        b.data.clear();
+    }
+    gPorts.storeRelease(0);
+    
+    gGeneration.fetchAndAddOrdered(1);
+    gActive.storeRelease(1);
+    
+    gWriter = new dxl_capture_writer();
+    gWriter->start(QThread::LowPriority);
+    return true;
+}
+
+void dxl_capture::stop()
+{
+    gActive.storeRelease(0);
+    if (gWriter == NULL) return;
+    
+    gWriter->finish();
+    delete gWriter;
+    gWriter = NULL;
+    
+    flush();
+    QMutexLocker m(&gMutex);
+    gFile.close();
+}
+
+int dxl_capture::add_port(const QString &name, double latency)
+{
+    if (not is_active()) return -1;
+    
+    int port = gPorts.fetchAndAddOrdered(1);
+    if (port >= MaxPorts) return -1;
+    
+    QByteArray data;
+    put_varint(data, quint64(qMax(latency, 0.0)*1000.0 + 0.5));
+    data.append(name.toUtf8());
+    push(port, Port, dxl_clock::ns(), data.constData(), data.size());
+    return port;
+}
+
+void dxl_capture::record(int port, int kind, const unsigned char *data, int n,
+                         qint64 ns)
+{
+    if (port < 0 or port >= MaxPorts or n <= 0 or not is_active()) return;
+    push(port, kind, ns, reinterpret_cast<const char*>(data), n);
+}
+
+void dxl_capture::push(int port, int kind, qint64 ns, const char *data, int n)
+{
+    // Nobody else uses the lock but the writer for a moment, the block is 
+    // copied as it is and encoded by the writer
+    buffer &b = gBuffers[port];
+    QMutexLocker m(&b.mutex);
+    qint32 head[2] = { kind, n };
+    b.data.append(reinterpret_cast<const char*>(&ns), sizeof(ns));
+    b.data.append(reinterpret_cast<const char*>(head), sizeof(head));
+    b.data.append(data, n);
+}
+
+void dxl_capture::append(int port, int kind, qint64 ns, const char *data,
+                         int n)
+{
+    // A port thread could have taken its time before the previous write
+    // and added the block after it
+    qint64 delta = qMax(ns - gLast, Q_INT64_C(0));
+    gLast += delta;
+    
+    put_varint(gOut, quint64(port) << 2 | quint64(kind));
+    put_varint(gOut, quint64(delta));
+    put_varint(gOut, quint64(n));
+    gOut.append(data, n);
+}
+
+void dxl_capture::flush()
+{
+    QMutexLocker m(&gMutex);
+    if (not gFile.isOpen()) return;
+    
+    // The buffers are swapped, the ports go on with empty ones
+    QByteArray taken[MaxPorts];
+    int ports = qMin(int(gPorts.loadAcquire()), int(MaxPorts));
+    for (int p = 0; p < ports; ++p) {
+        QMutexLocker l(&gBuffers[p].mutex);
+        taken[p].swap(gBuffers[p].data);
+    }
+    
+    // The blocks of every port keep their order, the port record is added
+    // after the time of the first block is taken
+    const int head = sizeof(qint64) + 2*sizeof(qint32);
+    QVector<dxl_capture_block> blocks;
+    for (int p = 0; p < ports; ++p) {
+        const char *d = taken[p].constData();
+        qint64 key = 0;
+        for (int pos = 0; pos + head <= taken[p].size(); ) {
+            dxl_capture_block b;
+            qint32 kn[2];
+            std::memcpy(&b.ns, d + pos, sizeof(qint64));
+            std::memcpy(kn, d + pos + sizeof(qint64), sizeof(kn));
+            b.port = p;
+            b.kind = kn[0];
+            b.n = kn[1];
+            b.data = d + pos + head;
+            b.key = key = qMax(key, b.ns);
+            blocks.append(b);
+            pos += head + b.n;
+        }
+    }
+    std::stable_sort(blocks.begin(), blocks.end());
+    
+    for (const dxl_capture_block &b : blocks) 
+        append(b.port, b.kind, b.ns, b.data, b.n);
+    if (gOut.isEmpty()) return;
+    
+    gFile.write(gOut);
+    gFile.flush();
+    gOut.clear();
+}
+
+bool dxl_capture::load(const QString &file, QVector<dxl_capture_port> &ports,
+                       QVector<dxl_capture_record> &records)
+{
+    ports.clear();
+    records.clear();
+    
+    QFile f(file);
+    if (not f.open(QIODevice::ReadOnly)) return false;
+    QByteArray buf = f.readAll();
+    
+    // The magic size counts the version byte instead of the terminator
+    int pos = sizeof(CAPTURE_MAGIC);
+    if (not buf.startsWith(CAPTURE_MAGIC) or buf.size() < pos or
+        buf[pos - 1] != char(CAPTURE_VERSION)) return false;
+    
+    qint64 ns = 0;
+    quint64 key, delta, n;
+    while (get_varint(buf, pos, key) and get_varint(buf, pos, delta) and
+           get_varint(buf, pos, n) and n <= quint64(buf.size() - pos)) {
+        QByteArray data = buf.mid(pos, int(n));
+        pos += int(n);
+        ns += qint64(delta);
+        
+        int port = int(key >> 2);
+        int kind = int(key & 3);
+        if (kind == Port) {
+            int p = 0;
+            quint64 latency;
+            if (not get_varint(data, p, latency)) continue;
+            
+            dxl_capture_port cp = { QString::fromUtf8(data.mid(p)),
+                                    latency / 1000.0 };
+            if (port >= ports.size()) ports.resize(port + 1);
+            ports[port] = cp;
+        }
+        else if (port < ports.size()) {
+            dxl_capture_record r = { ns, port, kind, data };
+            records.append(r);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,148 @@
+/// @file dxl_capture.h Contains the dxl_capture class declaration
+#ifndef _DYNAMIXEL_CAPTURE_HEADER
+#define _DYNAMIXEL_CAPTURE_HEADER
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/// A block of bytes sent or received by a port
+struct dxl_capture_record {
+    qint64 ns;          ///< Time in ns since the capture started
+    int port;           ///< Port index
+    int kind;           ///< dxl_capture::Tx or dxl_capture::Rx
+    QByteArray data;    ///< Bytes
+};
+
+/// A port of a capture
+struct dxl_capture_port {
+    QString name;       ///< Port name
+    double latency;     ///< Adapter latency in ms used in the timeouts
+};
+
+class dxl_capture_writer;
+
+/// Records the bytes sent and received by all the open ports to a capture
+/// file. Every block written to a port or read from it is stored with its
+/// monotonic time, so the bus traffic can be replayed later with the
+/// "replay:" port (dxl_port_replay).
+///
+/// The file starts with "DXLC" and the format version, then there's a
+/// record after another. Every record has three varints, (port << 2 | kind),
+/// the ns since the previous record and the data length, and then the data.
+/// The port records contain the port latency in µs (varint) and its name.
+/// While there isn't any capture the recording costs an atomic load.
+///
+/// Every port appends its blocks to its own buffer, only its bus thread and
+/// the writer thread take the buffer lock. The writer thread merges the
+/// buffers of all the ports in time order and writes them to the file, so
+/// the bus transactions never wait for the disk.
+class dxl_capture {
+public:
+    
+    /// Kinds of records
+    enum Kind {
+        Port,   ///< A new port
+        Tx,     ///< Bytes sent
+        Rx      ///< Bytes received
+    };
+    
+    /// Starts a new capture, the previous one is stopped
+    /// @param file Path of the capture file
+    /// @return False if the file can't be written
+    static bool start(const QString &file);
+    
+    /// Stops the capture and writes the pending records
+    static void stop();
+    
+    /// Returns true while capturing
+    static inline bool is_active() { return gActive.load() != 0; }
+    
+    /// Returns a number that changes with every capture, the ports must be
+    /// added again when it changes
+    static inline int generation() { return gGeneration.load(); }
+    
+    /// Adds a port to the capture
+    /// @param name Port name
+    /// @param latency Adapter latency in ms
+    /// @return Port index, -1 if there isn't any capture
+    static int add_port(const QString &name, double latency);
+    
+    /// Adds a block of bytes
+    /// @param port Port index returned by add_port()
+    /// @param kind Tx or Rx
+    /// @param data Bytes
+    /// @param n Number of bytes
+    /// @param ns Monotonic time in ns when they were sent or received
+    static void record(int port, int kind, const unsigned char *data, int n,
+                       qint64 ns);
+    
+    /// Reads a capture file
+    /// @param file Path of the capture file
+    /// @param ports Stores the captured ports
+    /// @param records Stores the sent and received blocks in order
+    /// @return False if the file can't be read or it isn't a capture, a
+    /// truncated last record is ignored
+    static bool load(const QString &file, QVector<dxl_capture_port> &ports,
+                     QVector<dxl_capture_record> &records);
+    
+private:
+    
+    friend class dxl_capture_writer;
+    
+    /// Records of a port not yet written
+    struct buffer {
+        QMutex mutex;       ///< Protects the data
+        QByteArray data;    ///< Time, kind, length and bytes of every block
+    };
+    
+    /// Most ports in a capture, the next ones aren't recorded
+    static const int MaxPorts = 16;
+    
+    /// Time in ns between two writes to the file
+    static const qint64 FlushTime = 200000000LL;
+    
+    /// Protects the file and the encoder state
+    static QMutex gMutex;
+    
+    /// Capture file
+    static QFile gFile;
+    
+    /// Records encoded and not yet written
+    static QByteArray gOut;
+    
+    /// Time of the last encoded record in ns
+    static qint64 gLast;
+    
+    /// Records of every port
+    static buffer gBuffers[MaxPorts];
+    
+    /// Number of ports added
+    static QAtomicInt gPorts;
+    
+    /// True while capturing
+    static QAtomicInt gActive;
+    
+    /// Capture number
+    static QAtomicInt gGeneration;
+    
+    /// Writes the records to the file, started and stopped with the capture
+    static dxl_capture_writer *gWriter;
+    
+    /// Appends a block to the buffer of a port
+    static void push(int port, int kind, qint64 ns, const char *data, int n);
+    
+    /// Encodes a record in the file format
+    /// @pre The mutex is locked
+    static void append(int port, int kind, qint64 ns, const char *data,
+                       int n);
+    
+    /// Takes the records of all the ports in time order and writes them to 
+    /// the file
+    static void flush();
+};
+
+#endif
@@ -0,0 +1,32 @@
+/// @file dxl_clock.h Contains the dxl_clock class declaration and
+/// implementation
+#ifndef _DYNAMIXEL_CLOCK_HEADER
+#define _DYNAMIXEL_CLOCK_HEADER
+
+#include <chrono>
+#include <QtGlobal>
+
+/// Monotonic clock with nanosecond resolution used for the packet timeouts
+/// and the control loop timing. It never goes backwards and it doesn't 
+/// follow the wall clock adjustments.
+class dxl_clock {
+    
+    typedef std::chrono::steady_clock clock;
+    
+public:
+    
+    /// Returns the current time in ns
+    static inline qint64 ns()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    clock::now().time_since_epoch()).count();
+    }
+    
+    /// Returns the current time in µs
+    static inline qint64 us() { return ns() / 1000; }
+    
+    /// Returns the current time in ms with sub millisecond resolution
+    static inline double ms() { return ns() / 1000000.0; }
+};
+
+#endif
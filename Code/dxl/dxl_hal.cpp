@@ -2,7 +2,6 @@
 /// source
 #include "dxl_hal.h"
 
-
 bool dxl_hal::open(QString &devName, int baudrate )
 {
     // Opening device
@@ -10,37 +9,43 @@ bool dxl_hal::open(QString &devName, int baudrate )
 	// baudrate: Real baudrate (ex> 115200, 57600, 38400...)
 	// Return: 0(Failed), 1(Succeed)
     
-    _serial.setPortName(devName);
-    _serial.setBaudRate(qint32(baudrate));
-    _serial.setDataBits(QSerialPort::Data8);
-    _serial.setParity(QSerialPort::NoParity);
-    _serial.setStopBits(QSerialPort::OneStop);
-    _serial.setFlowControl(QSerialPort::NoFlowControl);
-    if(not _serial.open(QIODevice::ReadWrite)) return false;
-    _open = true;
+    close();
+    
+    QString device;
+    _name = devName;
+    _port = dxl_port::create(devName, device);
+    if (_port == NULL) return false;
+    
+    if (not _port->open(device, baudrate)) {
+        close();
+        return false;
+    }
     return true;
 }
 
 void dxl_hal::close()
 {
 	// Closing device
-    _serial.close();
-    _open = false;
+    if (_port != NULL) _port->close();
+    delete _port;
+    _port = NULL;
+    _rx.clear();
 }
 
 void dxl_hal::clear(void)
 {
 	// Clear communication buffer
     
-    if (!_serial.isOpen()) return;
-    _serial.clear();
+    if (not isOpen()) return;
+    _port->clear();
+    _rx.clear();
     
 }
 
 int dxl_hal::change_baudrate(float baudrate)
 {
-    bool res = _serial.setBaudRate(qint32(baudrate));
-    return int(res);
+    if (not isOpen()) return 0;
+    return int(_port->set_baudrate(qint32(baudrate)));
     
 }
 
@@ -50,35 +55,67 @@ int dxl_hal::write( unsigned char *pPacket, int numPacket )
 	// *pPacket: data array pointer
 	// numPacket: number of data array
 	// Return: number of data transmitted. -1 is error.
-    _timed = false;
-    if (_serial.isOpen()) {
-        int n = _serial.write((char*)pPacket, numPacket);
-        _timed = _serial.waitForBytesWritten(_time);
-        _timed = not _timed;
-        return n;
-    }
-    else return -1;
+    if (not isOpen()) return -1;
+    
+    int n = _port->write(pPacket, numPacket);
+    if (n > 0 and dxl_capture::is_active())
+        capture(dxl_capture::Tx, pPacket, n, get_curr_time());
+    return n;
 
 }
 
 int dxl_hal::read( unsigned char *pPacket, int numPacket )
 {
-	// Recieving date
+	// Recieving date, doesn't block, use wait() to wait for new bytes
 	// *pPacket: data array pointer
 	// numPacket: number of data array
 	// Return: number of data recieved. -1 is error.
-    _timed = false;
-    if (_serial.isOpen()) {
-        int n = _serial.read((char*)pPacket, numPacket);
-        _timed = _serial.waitForReadyRead(_time);
-        _timed = not _timed;
-        return n;
-    }
-    else return -1;
+    if (not isOpen()) return -1;
     
+    if (_rx.size() < numPacket) fill();
+    return _rx.pop(pPacket, numPacket);
 }
 
-double dxl_hal::get_curr_time()
+bool dxl_hal::wait(int usec)
 {
-    return (double)QTime::currentTime().msecsSinceStartOfDay();
+    if (not isOpen()) return false;
+    
+    fill();
+    if (not _rx.empty()) return true;
+    if (usec <= 0) return false;
+    
+    if (not _port->wait(usec)) return false;
+    
+    fill();
+    return not _rx.empty();
+}
+
+double dxl_hal::get_latency()
+{
+    if (_latency >= 0.0) return _latency;
+    if (isOpen()) return _port->latency();
+    return 16.0;
+}
+
+void dxl_hal::fill()
+{
+    unsigned char buf[RX_RING_SIZE];
+    
+    int n = _port->read(buf, _rx.free());
+    if (n <= 0) return;
+    
+    _rx.push(buf, n);
+    _rxTime = get_curr_time();
+    
+    if (dxl_capture::is_active()) capture(dxl_capture::Rx, buf, n, _rxTime);
+}
+
+void dxl_hal::capture(int kind, const unsigned char *data, int n, qint64 ns)
+{
+    int generation = dxl_capture::generation();
+    if (_capGen != generation) {
+        _capPort = dxl_capture::add_port(_name, get_latency());
+        _capGen = generation;
+    }
+    dxl_capture::record(_capPort, kind, data, n, ns);
 }
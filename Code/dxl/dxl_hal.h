@@ -3,30 +3,94 @@
 #ifndef _DYNAMIXEL_HAL_HEADER
 #define _DYNAMIXEL_HAL_HEADER
 
-#include <QSerialPort>
 #include <QString>
-#include <QTime>
+
+#include "dxl_capture.h"
+#include "dxl_clock.h"
+#include "dxl_port.h"
+#include "dxl_ring.h"
 
 #define MAXNUM_TXPACKET  (10000)
 #define MAXNUM_RXPACKET  (10000)
 
+/// Size of the reception ring buffer, must be a power of 2
+#define RX_RING_SIZE     (4096)
+
 /// Dynamixel SDK platform dependent
 class dxl_hal {
 private:
-    QSerialPort _serial;
     
-    int _time = 30;
-    bool _timed = false;
-    bool _open = false;
+    /// Serial port backend, NULL if the port is closed
+    dxl_port *_port = NULL;
+    
+    /// Contains the received bytes not yet read
+    dxl_ring<RX_RING_SIZE> _rx;
+    
+    /// Time in ns when the last received bytes arrived
+    qint64 _rxTime = 0;
+    
+    /// Latency in ms selected by the user, negative to use the port one
+    double _latency = -1.0;
+    
+    /// Port name with the backend prefix
+    QString _name;
+    
+    /// Port index in the capture and capture generation it belongs to
+    int _capPort = -1, _capGen = 0;
+    
+    /// Adds sent or received bytes to the capture, the port is added to
+    /// every new capture the first time it's used
+    void capture(int kind, const unsigned char *data, int n, qint64 ns);
+    
+    /// Moves all the bytes waiting in the port to the ring buffer
+    void fill();
+    
+    Q_DISABLE_COPY(dxl_hal)
     
 public:
+    
+    /// Default constructor
+    dxl_hal() {}
+    
+    /// Default destructor
+    ~dxl_hal() { close(); }
+    
+    /// Opens the port, the backend is selected by the name prefix
+    /// @see dxl_port
     bool open(QString &devName, int baudrate );
     void close(void);
     void clear(void);
     int change_baudrate(float baudrate);
     int write( unsigned char *pPacket, int numPacket );
     int read( unsigned char *pPacket, int numPacket );
-    double get_curr_time();
-    inline bool isOpen() { return _open; }
+    
+    /// Blocks until some bytes are received or the timeout expires
+    /// @param usec Maximum waiting time in µs
+    /// @return True if there are bytes to read
+    bool wait(int usec);
+    
+    /// Returns the time in ns when the last read bytes arrived
+    inline qint64 get_rx_time() { return _rxTime; }
+    
+    /// Returns the current monotonic time in ns
+    inline qint64 get_curr_time() { return dxl_clock::ns(); }
+    
+    inline bool isOpen() { return _port != NULL and _port->isOpen(); }
+    
+    /// Returns the latency in ms added to every transmission direction
+    double get_latency();
+    
+    /// Sets the latency in ms added to every transmission direction
+    /// @param msec Latency, negative to use the one of the port
+    inline void set_latency(double msec) { _latency = msec; }
+    
+    /// Returns the latency given to set_latency(), negative if none
+    inline double get_latency_setting() { return _latency; }
+    
+    /// Returns the faults injected by the port since it was opened
+    inline dxl_fault_stats get_faults() 
+    { 
+        return _port != NULL ? _port->faults() : dxl_fault_stats(); 
+    }
 };
 #endif
@@ -0,0 +1,132 @@
+/// @file dxl_parser.cpp Contains the dxl_parser class implementation
+#include "dxl_parser.h"
+
+#include <cstring>
+
+void dxl_parser::set_protocol(const dxl_protocol *protocol)
+{
+    _protocol = protocol;
+    clear();
+}
+
+void dxl_parser::clear()
+{
+    _head = _scan = _tail = 0;
+    _ready = 0;
+    _length = 0;
+    _state = Header;
+}
+
+int dxl_parser::discard()
+{
+    int n = _ready;
+    _head = _scan;
+    _ready = 0;
+    return n;
+}
+
+int dxl_parser::feed(const unsigned char *data, int n)
+{
+    if (_protocol == NULL) return 0;
+    
+    int used = 0;
+    while (used < n) {
+        // Moves the bytes to the start when the end of the buffer is
+        // reached, only the waiting packets and the current one are kept
+        if (_tail == PARSER_BUFFER_SIZE) {
+            if (_head == 0) break;
+            memmove(_buf, &_buf[_head], _tail - _head);
+            _scan -= _head;
+            _tail -= _head;
+            _head = 0;
+        }
+        
+        int k = qMin(n - used, PARSER_BUFFER_SIZE - _tail);
+        memcpy(&_buf[_tail], &data[used], k);
+        _tail += k;
+        used += k;
+        
+        parse();
+    }
+    
+    _stats.bytes += used;
+    return used;
+}
+
+void dxl_parser::drop(int n)
+{
+    _stats.dropped += n;
+    
+    // Usually there aren't packets waiting so nothing has to be moved
+    if (_scan == _head) {
+        _head += n;
+        _scan += n;
+    }
+    else {
+        memmove(&_buf[_scan], &_buf[_scan + n], _tail - _scan - n);
+        _tail -= n;
+    }
+    
+    if (_head == _tail) _head = _scan = _tail = 0;
+}
+
+void dxl_parser::parse()
+{
+    while (true) {
+        const unsigned char *p = &_buf[_scan];
+        int n = _tail - _scan;
+        
+        switch (_state) {
+        case Header: {
+            int start = _protocol->find_header(p, n);
+            if (start > 0) drop(start);
+            if (_tail - _scan < _protocol->header_length()) return;
+            _state = Length;
+            break;
+        }
+        case Length:
+            _length = _protocol->packet_length(p, n);
+            
+            // Impossible length, it was a false header
+            if (_length < _protocol->status_length(0) or
+                _length > PARSER_BUFFER_SIZE) {
+                ++_stats.corrupt;
+                drop(1);
+                _state = Header;
+                break;
+            }
+            _state = Body;
+            break;
+            
+        case Body:
+            if (n < _length) return;
+            
+            if (_protocol->check(p, _length)) {
+                _scan += _length;
+                ++_ready;
+                ++_stats.packets;
+            }
+            else {
+                // The next header could be inside the wrong packet
+                ++_stats.corrupt;
+                drop(1);
+            }
+            _state = Header;
+            break;
+        }
+    }
+}
+
+bool dxl_parser::next(dxl_status &st)
+{
+    if (_ready == 0) return false;
+    
+    const unsigned char *p = &_buf[_head];
+    int length = _protocol->packet_length(p, _scan - _head);
+    _protocol->parse(p, length, st);
+    _head += length;
+    --_ready;
+    
+    if (_head == _tail) _head = _scan = _tail = 0;
+    return true;
+}
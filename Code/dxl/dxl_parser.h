@@ -0,0 +1,114 @@
+/// @file dxl_parser.h Contains the dxl_parser class declaration
+#ifndef _DYNAMIXEL_PARSER_HEADER
+#define _DYNAMIXEL_PARSER_HEADER
+
+#include "dxl_protocol.h"
+
+/// Size of the parser buffer, it must hold the biggest status packet
+#define PARSER_BUFFER_SIZE  (MAXNUM_RXPACKET)
+
+/// Statistics of the parsed byte stream
+struct dxl_parser_stats {
+    long long bytes = 0;    ///< Bytes received
+    long long packets = 0;  ///< Correct status packets found
+    long long dropped = 0;  ///< Bytes discarded while searching a header
+    long long corrupt = 0;  ///< Packets with a wrong length or checksum
+};
+
+/// Incremental status packet parser. The received bytes are added as they
+/// arrive, whole packets are checked in place and kept in order until they
+/// are taken, so several status packets can be waiting. Any byte that
+/// doesn't belong to a correct packet is skipped and the parser continues
+/// from the next header, so a glitch only loses the packet it hits. It
+/// doesn't use the serial port, so it can also parse recorded streams.
+class dxl_parser {
+private:
+    
+    /// Parser states
+    enum State {
+        Header,     ///< Searching the packet header
+        Length,     ///< Waiting for the length field
+        Body        ///< Waiting for the rest of the packet
+    };
+    
+    /// Packet format, not owned
+    const dxl_protocol *_protocol = NULL;
+    
+    /// Contains the received bytes
+    unsigned char _buf[PARSER_BUFFER_SIZE];
+    
+    /// Start of the first checked packet
+    int _head = 0;
+    
+    /// Start of the packet being parsed, all the packets before it are
+    /// correct
+    int _scan = 0;
+    
+    /// End of the received bytes
+    int _tail = 0;
+    
+    /// Number of checked packets between _head and _scan
+    int _ready = 0;
+    
+    /// Length of the packet being parsed, 0 if it's not known yet
+    int _length = 0;
+    
+    /// Current state
+    State _state = Header;
+    
+    /// Stream statistics
+    dxl_parser_stats _stats;
+    
+    /// Discards bytes at the start of the packet being parsed
+    void drop(int n);
+    
+    /// Parses the received bytes until more are needed
+    void parse();
+    
+public:
+    
+    /// Default constructor
+    /// @param protocol Packet format, it must exist while it's used
+    dxl_parser(const dxl_protocol *protocol = NULL) : _protocol(protocol) {}
+    
+    /// Selects the packet format, the received bytes are discarded
+    void set_protocol(const dxl_protocol *protocol);
+    
+    /// Discards all the received bytes and packets
+    void clear();
+    
+    /// Discards the packets already checked, the bytes of an incomplete
+    /// packet are kept
+    /// @return Number of packets discarded
+    int discard();
+    
+    /// Adds received bytes, the complete packets are checked
+    /// @return Number of bytes used, less than n only if the buffer is full
+    /// of packets not taken yet
+    int feed(const unsigned char *data, int n);
+    
+    /// Returns the number of checked packets waiting
+    inline int ready() const { return _ready; }
+    
+    /// Returns the number of received bytes not yet taken
+    inline int size() const { return _tail - _head; }
+    
+    /// Returns the number of bytes that can be added
+    inline int free() const { return PARSER_BUFFER_SIZE - size(); }
+    
+    /// Returns true if part of a packet has been received
+    inline bool partial() const { return _tail > _scan; }
+    
+    /// Takes the first checked packet
+    /// @param st Stores the decoded packet
+    /// @return False if there isn't any packet waiting
+    bool next(dxl_status &st);
+    
+    /// Returns the stream statistics
+    inline const dxl_parser_stats& stats() const { return _stats; }
+    
+    /// Clears the stream statistics
+    inline void reset_stats() { _stats = dxl_parser_stats(); }
+};
+
+#endif
@@ -0,0 +1,32 @@
+/// @file dxl_port.cpp Contains the dxl_port class implementation
+#include "dxl_port.h"
+#include "dxl_port_fault.h"
+#include "dxl_port_qt.h"
+#include "dxl_port_replay.h"
+#include "dxl_port_sim.h"
+#include "dxl_port_tty.h"
+
+dxl_port* dxl_port::create(const QString &name, QString &device)
+{
+    int colon = name.indexOf(':');
+    QString prefix = colon > 0 ? name.left(colon) : QString();
+    
+    // Windows names like "COM3" don't have a prefix
+    if (prefix == "tty" or prefix == "qt" or prefix == "replay" or
+        prefix == "replay-fast" or prefix == "sim" or
+        prefix == "fault") device = name.mid(colon + 1);
+    else {
+        prefix.clear();
+        device = name;
+    }
+    
+#ifdef Q_OS_LINUX
+    if (prefix == "tty" or prefix.isEmpty()) return new dxl_port_tty();
+#endif
+    if (prefix == "qt" or prefix.isEmpty()) return new dxl_port_qt();
+    if (prefix == "replay") return new dxl_port_replay(false);
+    if (prefix == "replay-fast") return new dxl_port_replay(true);
+    if (prefix == "sim") return new dxl_port_sim();
+    if (prefix == "fault") return new dxl_port_fault();
+    return NULL;
+}
@@ -0,0 +1,80 @@
+/// @file dxl_port.h Contains the dxl_port class declaration
+#ifndef _DYNAMIXEL_PORT_HEADER
+#define _DYNAMIXEL_PORT_HEADER
+
+#include <QString>
+
+/// Number of faults injected by a port, only dxl_port_fault injects
+/// them
+struct dxl_fault_stats {
+    int packets = 0;    ///< Status packets received
+    int dropped = 0;    ///< Packets that lost a byte
+    int flipped = 0;    ///< Packets with a flipped bit
+    int truncated = 0;  ///< Packets cut short
+    int late = 0;       ///< Packets delivered late
+    int dead = 0;       ///< Packets of dead IDs removed
+};
+
+/// Byte stream used to talk with the servos. The backend is selected with a
+/// prefix in the port name:
+/// - "tty:" Native Linux serial port with termios
+/// - "qt:" QSerialPort
+/// - "replay:" Plays back a capture with the original timing, see
+///   dxl_capture
+/// - "replay-fast:" Plays back a capture as fast as possible
+/// - "sim:" Simulated AX-12 servos, see dxl_port_sim
+/// - "fault:" Injects faults in another port, see dxl_port_fault
+///
+/// A name without prefix uses the native backend on Linux and QSerialPort on
+/// the other systems.
+class dxl_port {
+public:
+    
+    /// Default destructor
+    virtual ~dxl_port() {}
+    
+    /// Returns a new port for the selected name, NULL if the backend isn't
+    /// available
+    /// @param name Port name with an optional backend prefix
+    /// @param device Stores the name without the prefix
+    static dxl_port* create(const QString &name, QString &device);
+    
+    /// Opens the port with 8N1 format and without flow control
+    /// @param device Device name without the backend prefix
+    /// @param baudrate Baud rate in bps
+    virtual bool open(const QString &device, int baudrate) = 0;
+    
+    /// Closes the port
+    virtual void close() = 0;
+    
+    /// True if the port is open
+    virtual bool isOpen() const = 0;
+    
+    /// Discards the bytes received and not sent
+    virtual void clear() = 0;
+    
+    /// Changes the baud rate
+    virtual bool set_baudrate(int baudrate) = 0;
+    
+    /// Sends bytes
+    /// @return Number of bytes sent, -1 if there's an error
+    virtual int write(const unsigned char *data, int n) = 0;
+    
+    /// Takes the received bytes, it never blocks
+    /// @return Number of bytes read, -1 if there's an error
+    virtual int read(unsigned char *data, int n) = 0;
+    
+    /// Blocks until some bytes can be read or the timeout expires
+    /// @param usec Maximum waiting time in µs
+    /// @return True if there are bytes to read
+    virtual bool wait(int usec) = 0;
+    
+    /// Returns the time in ms the adapter can keep a received byte before
+    /// delivering it, the timeouts add it in both directions
+    virtual double latency() const = 0;
+    
+    /// Returns the faults injected since the port was opened
+    virtual dxl_fault_stats faults() const { return dxl_fault_stats(); }
+};
+
+#endif
@@ -0,0 +1,202 @@
+/// @file dxl_port_fault.cpp Contains the dxl_port_fault class implementation
+#include "dxl_port_fault.h"
+#include "dxl_clock.h"
+#include "dynamixel.h"
+
+#include <QStringList>
+
+#include <cstring>
+
+bool dxl_port_fault::open(const QString &device, int baudrate)
+{
+    close();
+    
+    int at = device.indexOf('@');
+    if (at < 0) return false;
+    
+    // Every option must be known, a typo would give a clean link
+    _gen.seed(1);
+    for (const QString &opt : device.left(at).split(',')) {
+        if (opt.isEmpty()) continue;
+        
+        int eq = opt.indexOf('=');
+        if (eq <= 0) return false;
+        
+        QString key = opt.left(eq);
+        bool ok;
+        double value = opt.mid(eq + 1).toDouble(&ok);
+        if (not ok or value < 0) return false;
+        
+        if (key == "drop") _drop = value;
+        else if (key == "flip") _flip = value;
+        else if (key == "truncate") _truncate = value;
+        else if (key == "late") _late = value;
+        else if (key == "latems") _lateTime = qint64(value*1000000.0);
+        else if (key == "dead") _dead.append(int(value));
+        else if (key == "seed") _gen.seed(quint32(value));
+        else return false;
+    }
+    
+    QString inner;
+    _port = dxl_port::create(device.mid(at + 1), inner);
+    if (_port == NULL) return false;
+    if (not _port->open(inner, baudrate)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void dxl_port_fault::close()
+{
+    if (_port != NULL) _port->close();
+    delete _port;
+    _port = NULL;
+    
+    _drop = _flip = _truncate = _late = 0.0;
+    _lateTime = 5000000;
+    _dead.clear();
+    _in.clear();
+    _out.clear();
+    _stats = dxl_fault_stats();
+}
+
+void dxl_port_fault::clear()
+{
+    if (_port != NULL) _port->clear();
+    _in.clear();
+    _out.clear();
+}
+
+bool dxl_port_fault::set_baudrate(int baudrate)
+{
+    return _port != NULL and _port->set_baudrate(baudrate);
+}
+
+int dxl_port_fault::write(const unsigned char *data, int n)
+{
+    if (not isOpen()) return -1;
+    
+    // An incomplete packet won't be completed by the new answers
+    if (not _in.isEmpty()) push(_in, dxl_clock::ns());
+    _in.clear();
+    
+    return _port->write(data, n);
+}
+
+int dxl_port_fault::read(unsigned char *data, int n)
+{
+    if (not isOpen()) return -1;
+    
+    pull();
+    int k = 0;
+    while (k < n and ready()) {
+        block &b = _out.first();
+        int m = qMin(n - k, b.data.size());
+        std::memcpy(data + k, b.data.constData(), m);
+        k += m;
+        
+        b.data.remove(0, m);
+        if (b.data.isEmpty()) _out.removeFirst();
+    }
+    return k;
+}
+
+bool dxl_port_fault::wait(int usec)
+{
+    if (not isOpen()) return false;
+    
+    qint64 now = dxl_clock::ns();
+    qint64 deadline = now + qint64(qMax(usec, 0))*1000;
+    for (;;) {
+        pull();
+        if (ready()) return true;
+        
+        now = dxl_clock::ns();
+        if (now >= deadline) return false;
+        
+        // Wakes up when the port receives bytes or the late ones are due
+        qint64 until = deadline;
+        if (not _out.isEmpty()) until = qMin(until, _out.first().due);
+        _port->wait(int((until - now + 999)/1000));
+    }
+}
+
+void dxl_port_fault::pull()
+{
+    unsigned char buf[1024];
+    int n;
+    while ((n = _port->read(buf, sizeof(buf))) > 0) _in.append((char*)buf, n);
+    
+    for (;;) {
+        const unsigned char *p = (const unsigned char*)_in.constData();
+        
+        // The bytes between packets go through untouched
+        int h = _p1.find_header(p, _in.size());
+        if (h > 0) {
+            push(_in.left(h), dxl_clock::ns());
+            _in.remove(0, h);
+            p = (const unsigned char*)_in.constData();
+        }
+        
+        // 0xFD isn't a valid Protocol 1.0 ID
+        if (_in.size() < 3) return;
+        bool v2 = p[2] == 0xFD;
+        const dxl_protocol *proto = v2 ? (const dxl_protocol*)&_p2 : &_p1;
+        
+        int len = proto->packet_length(p, _in.size());
+        if (len == 0 or len > _in.size()) return;
+        
+        inject(_in.left(len), v2 ? PRT2_PKT_ID : PRT1_PKT_ID);
+        _in.remove(0, len);
+    }
+}
+
+void dxl_port_fault::inject(QByteArray pkt, int idPos)
+{
+    ++_stats.packets;
+    if (_dead.contains(uchar(pkt[idPos]))) {
+        ++_stats.dead;
+        return;
+    }
+    
+    // The same number of draws for every packet, so a seed always gives
+    // the same faults for the same traffic
+    std::uniform_real_distribution<double> prob(0.0, 1.0);
+    double late = prob(_gen), truncate = prob(_gen), flip = prob(_gen);
+    double drop = prob(_gen);
+    quint32 r1 = _gen(), r2 = _gen(), r3 = _gen();
+    
+    qint64 due = dxl_clock::ns();
+    if (late < _late) {
+        due += _lateTime;
+        ++_stats.late;
+    }
+    if (truncate < _truncate) {
+        pkt.truncate(1 + int(r1 % quint32(pkt.size() - 1)));
+        ++_stats.truncated;
+    }
+    if (flip < _flip) {
+        int bit = int(r2 % quint32(pkt.size()*8));
+        pkt[bit/8] = char(pkt[bit/8] ^ (1 << (bit%8)));
+        ++_stats.flipped;
+    }
+    if (drop < _drop and pkt.size() > 1) {
+        pkt.remove(int(r3 % quint32(pkt.size())), 1);
+        ++_stats.dropped;
+    }
+    push(pkt, due);
+}
+
+void dxl_port_fault::push(const QByteArray &data, qint64 due)
+{
+    // A late packet delays the ones behind it, like in the wire
+    if (not _out.isEmpty()) due = qMax(due, _out.last().due);
+    block b = { due, data };
+    _out.append(b);
+}
+
+bool dxl_port_fault::ready() const
+{
+    return not _out.isEmpty() and _out.first().due <= dxl_clock::ns();
+}
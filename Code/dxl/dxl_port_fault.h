@@ -0,0 +1,97 @@
+/// @file dxl_port_fault.h Contains the dxl_port_fault class declaration
+#ifndef _DYNAMIXEL_PORT_FAULT_HEADER
+#define _DYNAMIXEL_PORT_FAULT_HEADER
+
+#include "dxl_port.h"
+#include "dxl_protocol1.h"
+#include "dxl_protocol2.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+#include <random>
+
+/// Injects faults in the status packets received by another port, to see
+/// how the control loop behaves with a degraded link. The device name is
+/// "<faults>@<port>", the port is any name dxl_port::create() accepts and
+/// the faults are a comma separated list of:
+/// - "drop=p" Probability that a packet loses one of its bytes
+/// - "flip=p" Probability that a packet has a bit flipped
+/// - "truncate=p" Probability that a packet is cut short
+/// - "late=p" Probability that a packet is delivered late
+/// - "latems=ms" Delay of the late packets, 5 ms by default
+/// - "dead=id" The servo doesn't answer, it can be repeated
+/// - "seed=n" Random generator seed, the same seed and traffic give the
+///   same faults
+///
+/// For example "fault:drop=0.01,flip=0.01,seed=7@sim:" or
+/// "fault:dead=3@/dev/ttyUSB0". Both protocol versions are understood.
+class dxl_port_fault : public dxl_port {
+private:
+    
+    /// Bytes waiting for their delivery time
+    struct block {
+        qint64 due;         ///< Time in ns when they can be read
+        QByteArray data;    ///< Bytes
+    };
+    
+    /// Port with the real traffic, NULL if it's closed
+    dxl_port *_port = NULL;
+    
+    /// Packet formats, to find the status packets
+    dxl_protocol1 _p1;
+    dxl_protocol2 _p2;
+    
+    /// Fault probabilities per packet
+    double _drop = 0.0, _flip = 0.0, _truncate = 0.0, _late = 0.0;
+    
+    /// Delay of the late packets in ns
+    qint64 _lateTime = 5000000;
+    
+    /// IDs that don't answer
+    QVector<int> _dead;
+    
+    /// Random generator
+    std::mt19937 _gen;
+    
+    /// Received bytes not split into packets yet
+    QByteArray _in;
+    
+    /// Bytes to deliver
+    QList<block> _out;
+    
+    /// Injected faults
+    dxl_fault_stats _stats;
+    
+    /// Reads the bytes of the port and splits them into packets
+    void pull();
+    
+    /// Injects the faults in a status packet and queues it
+    void inject(QByteArray pkt, int idPos);
+    
+    /// Queues bytes to deliver, never before the previous ones
+    void push(const QByteArray &data, qint64 due);
+    
+    /// Returns true if the first queued bytes can be read
+    bool ready() const;
+    
+public:
+    
+    /// Default destructor
+    ~dxl_port_fault() { close(); }
+    
+    bool open(const QString &device, int baudrate);
+    void close();
+    bool isOpen() const { return _port != NULL and _port->isOpen(); }
+    void clear();
+    bool set_baudrate(int baudrate);
+    int write(const unsigned char *data, int n);
+    int read(unsigned char *data, int n);
+    bool wait(int usec);
+    double latency() const { return _port ? _port->latency() : 16.0; }
+    
+    dxl_fault_stats faults() const { return _stats; }
+};
+
+#endif
@@ -0,0 +1,69 @@
+/// @file dxl_port_qt.cpp Contains the dxl_port_qt class implementation
+#include "dxl_port_qt.h"
+
+#ifdef Q_OS_LINUX
+#include <poll.h>
+#endif
+
+bool dxl_port_qt::open(const QString &device, int baudrate)
+{
+    _serial.setPortName(device);
+    _serial.setBaudRate(qint32(baudrate));
+    _serial.setDataBits(QSerialPort::Data8);
+    _serial.setParity(QSerialPort::NoParity);
+    _serial.setStopBits(QSerialPort::OneStop);
+    _serial.setFlowControl(QSerialPort::NoFlowControl);
+    return _serial.open(QIODevice::ReadWrite);
+}
+
+void dxl_port_qt::clear()
+{
+    if (_serial.isOpen()) _serial.clear();
+}
+
+bool dxl_port_qt::set_baudrate(int baudrate)
+{
+    return _serial.setBaudRate(qint32(baudrate));
+}
+
+int dxl_port_qt::write(const unsigned char *data, int n)
+{
+    if (not _serial.isOpen()) return -1;
+    
+    int sent = int(_serial.write((const char*)data, n));
+    _serial.waitForBytesWritten(_time);
+    return sent;
+}
+
+int dxl_port_qt::read(unsigned char *data, int n)
+{
+    if (not _serial.isOpen()) return -1;
+    return int(_serial.read((char*)data, n));
+}
+
+bool dxl_port_qt::wait(int usec)
+{
+    if (not _serial.isOpen()) return false;
+    if (_serial.bytesAvailable() > 0) return true;
+    if (usec <= 0) return false;
+    
+#ifdef Q_OS_LINUX
+    // Sleeps on the descriptor until the driver has bytes for us, then
+    // QSerialPort reads them without waiting
+    struct pollfd fd;
+    fd.fd = int(_serial.handle());
+    fd.events = POLLIN;
+    fd.revents = 0;
+    
+    struct timespec ts;
+    ts.tv_sec = usec / 1000000;
+    ts.tv_nsec = (usec % 1000000) * 1000;
+    
+    if (ppoll(&fd, 1, &ts, NULL) <= 0) return false;
+    _serial.waitForReadyRead(0);
+#else
+    _serial.waitForReadyRead((usec + 999) / 1000);
+#endif
+    
+    return _serial.bytesAvailable() > 0;
+}
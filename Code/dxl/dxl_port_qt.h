@@ -0,0 +1,32 @@
+/// @file dxl_port_qt.h Contains the dxl_port_qt class declaration
+#ifndef _DYNAMIXEL_PORT_QT_HEADER
+#define _DYNAMIXEL_PORT_QT_HEADER
+
+#include "dxl_port.h"
+
+#include <QSerialPort>
+
+/// Serial port using QSerialPort, available in all the systems
+class dxl_port_qt : public dxl_port {
+private:
+    QSerialPort _serial;
+    
+    /// Maximum time in ms waiting for the bytes to be written
+    int _time = 30;
+    
+public:
+    bool open(const QString &device, int baudrate);
+    void close() { _serial.close(); }
+    bool isOpen() const { return _serial.isOpen(); }
+    void clear();
+    bool set_baudrate(int baudrate);
+    int write(const unsigned char *data, int n);
+    int read(unsigned char *data, int n);
+    bool wait(int usec);
+    
+    /// The adapter latency can't be known, the default USB2Dynamixel (FTDI)
+    /// latency timer is assumed
+    double latency() const { return 16.0; }
+};
+
+#endif
@@ -0,0 +1,109 @@
+/// @file dxl_port_replay.cpp Contains the dxl_port_replay class implementation
+#include "dxl_port_replay.h"
+#include "dxl_clock.h"
+
+#include <QDebug>
+#include <QThread>
+
+#include <cstring>
+
+bool dxl_port_replay::open(const QString &device, int)
+{
+    close();
+    
+    int hash = device.lastIndexOf('#');
+    QString file = hash >= 0 ? device.left(hash) : device;
+    QString name = hash >= 0 ? device.mid(hash + 1) : QString();
+    
+    QVector<dxl_capture_port> ports;
+    QVector<dxl_capture_record> records;
+    if (not dxl_capture::load(file, ports, records) or ports.isEmpty())
+        return false;
+    
+    int port = 0;
+    if (not name.isEmpty()) {
+        for (port = 0; port < ports.size(); ++port)
+            if (ports[port].name == name) break;
+        if (port == ports.size()) return false;
+    }
+    
+    for (const dxl_capture_record &r : records)
+        if (r.port == port) _records.append(r);
+    
+    _latency = ports[port].latency;
+    _open = true;
+    return true;
+}
+
+void dxl_port_replay::close()
+{
+    if (_open and _mismatches > 0)
+        qWarning() << "Replay:" << _mismatches
+                   << "instructions differ from the capture";
+    
+    _open = false;
+    _records.clear();
+    _queue.clear();
+    _next = 0;
+    _mismatches = 0;
+}
+
+int dxl_port_replay::write(const unsigned char *data, int n)
+{
+    if (not _open) return -1;
+    
+    // The answers received before the first instruction aren't replayed
+    while (_next < _records.size() and _records[_next].kind != dxl_capture::Tx)
+        ++_next;
+    
+    // Nobody answers once the capture has ended
+    if (_next == _records.size()) return n;
+    
+    const dxl_capture_record &tx = _records[_next++];
+    if (tx.data.size() != n or std::memcmp(tx.data.constData(), data, n) != 0)
+        ++_mismatches;
+    
+    qint64 now = dxl_clock::ns();
+    for (; _next < _records.size() and
+         _records[_next].kind == dxl_capture::Rx; ++_next) {
+        const dxl_capture_record &rx = _records[_next];
+        pending p = { _fast ? now : now + rx.ns - tx.ns, rx.data };
+        _queue.append(p);
+    }
+    return n;
+}
+
+int dxl_port_replay::read(unsigned char *data, int n)
+{
+    if (not _open) return -1;
+    
+    qint64 now = dxl_clock::ns();
+    int k = 0;
+    while (k < n and not _queue.isEmpty() and _queue.first().due <= now) {
+        pending &p = _queue.first();
+        int m = qMin(n - k, p.data.size());
+        std::memcpy(data + k, p.data.constData(), m);
+        k += m;
+        
+        p.data.remove(0, m);
+        if (p.data.isEmpty()) _queue.removeFirst();
+    }
+    return k;
+}
+
+bool dxl_port_replay::wait(int usec)
+{
+    if (not _open) return false;
+    
+    qint64 now = dxl_clock::ns();
+    if (not _queue.isEmpty() and _queue.first().due <= now) return true;
+    if (usec <= 0) return false;
+    
+    // Sleeps until the next block is due, or the whole timeout if there
+    // isn't any
+    qint64 until = now + qint64(usec)*1000;
+    if (not _queue.isEmpty()) until = qMin(until, _queue.first().due);
+    QThread::usleep((unsigned long)((until - now) / 1000));
+    
+    return not _queue.isEmpty() and _queue.first().due <= dxl_clock::ns();
+}
@@ -0,0 +1,71 @@
+/// @file dxl_port_replay.h Contains the dxl_port_replay class declaration
+#ifndef _DYNAMIXEL_PORT_REPLAY_HEADER
+#define _DYNAMIXEL_PORT_REPLAY_HEADER
+
+#include "dxl_capture.h"
+#include "dxl_port.h"
+
+#include <QList>
+
+/// Plays back a capture written by dxl_capture. Every instruction sent
+/// takes the next one of the capture and the bytes received after it are
+/// delivered again, with the original delays or at once. The device name
+/// is the capture file with an optional "#port" suffix to choose one of
+/// the captured ports, by default the first one.
+class dxl_port_replay : public dxl_port {
+private:
+    
+    /// A received block waiting for its time
+    struct pending {
+        qint64 due;         ///< Time in ns when it can be read
+        QByteArray data;    ///< Bytes not yet read
+    };
+    
+    /// True to deliver the answers without the captured delays
+    bool _fast;
+    
+    /// True if the capture is loaded
+    bool _open = false;
+    
+    /// Latency in ms of the captured port
+    double _latency = 16.0;
+    
+    /// Sent and received blocks of the captured port
+    QVector<dxl_capture_record> _records;
+    
+    /// Next record to play
+    int _next = 0;
+    
+    /// Received blocks given by the sent instructions
+    QList<pending> _queue;
+    
+    /// Sent instructions different from the captured ones
+    int _mismatches = 0;
+    
+public:
+    
+    /// Initialization constructor
+    /// @param fast True to deliver the answers as fast as possible
+    explicit dxl_port_replay(bool fast) : _fast(fast) {}
+    
+    /// Default destructor
+    ~dxl_port_replay() { close(); }
+    
+    bool open(const QString &device, int baudrate);
+    void close();
+    bool isOpen() const { return _open; }
+    void clear() { _queue.clear(); }
+    bool set_baudrate(int) { return _open; }
+    int write(const unsigned char *data, int n);
+    int read(unsigned char *data, int n);
+    bool wait(int usec);
+    
+    /// Returns the latency of the captured port
+    double latency() const { return _latency; }
+    
+    /// Returns the number of sent instructions different from the captured
+    /// ones, they are answered with the captured bytes anyway
+    inline int mismatches() const { return _mismatches; }
+};
+
+#endif
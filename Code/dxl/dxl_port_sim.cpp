@@ -0,0 +1,235 @@
+/// @file dxl_port_sim.cpp Contains the dxl_port_sim class implementation
+#include "dxl_port_sim.h"
+#include "dxl_clock.h"
+#include "dynamixel.h"
+
+#include <QStringList>
+#include <QThread>
+
+#include <cstdlib>
+
+/// Baud rate difference in % a servo still understands
+#define SIM_BAUD_TOLERANCE  (3)
+
+/// Instruction bytes included in the latency
+#define SIM_LATENCY_BYTES   (16)
+
+/// Instruction error bit of the error byte
+#define SIM_ERR_INSTRUCTION (64)
+
+bool dxl_port_sim::open(const QString &device, int baudrate)
+{
+    close();
+    if (baudrate <= 0) return false;
+    
+    QString ids = device.trimmed().isEmpty() ? QString("1,2,3,4") : device;
+    for (const QString &s : ids.split(',')) {
+        
+        // "id/baud" is a servo with another baud rate
+        int slash = s.indexOf('/');
+        bool ok, okBaud = true;
+        int id = s.left(slash).trimmed().toInt(&ok);
+        int baud = slash < 0 ? baudrate : s.mid(slash + 1).toInt(&okBaud);
+        if (not ok or not okBaud or id < 0 or id > MAX_ID or baud <= 0) {
+            _servos.clear();
+            return false;
+        }
+        _servos.append(dxl_sim_ax12(id, baud));
+    }
+    
+    set_baudrate(baudrate);
+    _open = true;
+    return true;
+}
+
+void dxl_port_sim::close()
+{
+    _open = false;
+    _servos.clear();
+    clear();
+}
+
+void dxl_port_sim::clear()
+{
+    _tx.clear();
+    _rx.clear();
+}
+
+bool dxl_port_sim::set_baudrate(int baudrate)
+{
+    if (baudrate <= 0) return false;
+    
+    _baudrate = baudrate;
+    _byteTime = 10000000000LL/baudrate;
+    return true;
+}
+
+int dxl_port_sim::write(const unsigned char *data, int n)
+{
+    if (not _open) return -1;
+    
+    // The instruction goes on the wire after the answers being sent
+    qint64 start = qMax(dxl_clock::ns(), _busFree);
+    _busFree = start + n*_byteTime;
+    _tx.append((const char*)data, n);
+    
+    // Every complete packet is executed once its last byte has arrived,
+    // the garbage before a header is dropped like the servos do
+    for (;;) {
+        const unsigned char *buf = (const unsigned char*)_tx.constData();
+        int h = _proto.find_header(buf, _tx.size());
+        _tx.remove(0, h);
+        buf = (const unsigned char*)_tx.constData();
+        
+        int len = _proto.packet_length(buf, _tx.size());
+        if (len == 0 or len > _tx.size()) break;
+        
+        bool ok = _proto.check(buf, len);
+        if (ok) execute(buf, _busFree);
+        _tx.remove(0, ok ? len : 1);
+    }
+    return n;
+}
+
+int dxl_port_sim::read(unsigned char *data, int n)
+{
+    if (not _open) return -1;
+    
+    qint64 now = dxl_clock::ns();
+    int k = 0;
+    while (k < n and not _rx.isEmpty() and next_byte() <= now) {
+        answer &a = _rx.first();
+        data[k++] = uchar(a.data[a.pos++]);
+        if (a.pos == a.data.size()) _rx.removeFirst();
+    }
+    return k;
+}
+
+bool dxl_port_sim::wait(int usec)
+{
+    if (not _open) return false;
+    
+    qint64 now = dxl_clock::ns();
+    if (not _rx.isEmpty() and next_byte() <= now) return true;
+    if (usec <= 0) return false;
+    
+    // Sleeps until the next byte arrives, or the whole timeout if nobody
+    // is answering
+    qint64 until = now + qint64(usec)*1000;
+    if (not _rx.isEmpty()) until = qMin(until, next_byte());
+    QThread::usleep((unsigned long)((until - now) / 1000));
+    
+    return not _rx.isEmpty() and next_byte() <= dxl_clock::ns();
+}
+
+double dxl_port_sim::latency() const
+{
+    qint64 delay = 0;
+    for (const dxl_sim_ax12 &s : _servos)
+        delay = qMax(delay, s.return_delay());
+    return (delay + SIM_LATENCY_BYTES*_byteTime) / 1000000.0;
+}
+
+dxl_sim_ax12* dxl_port_sim::find(int id)
+{
+    for (dxl_sim_ax12 &s : _servos) {
+        if (s.id() != id) continue;
+        if (std::abs(s.baudrate() - _baudrate)*100 <=
+            _baudrate*SIM_BAUD_TOLERANCE) return &s;
+    }
+    return NULL;
+}
+
+void dxl_port_sim::execute(const unsigned char *pkt, qint64 end)
+{
+    int id = pkt[PRT1_PKT_ID];
+    int inst = pkt[PRT1_PKT_INSTRUCTION];
+    const unsigned char *p = &pkt[PRT1_PKT_PARAMETER0];
+    int n = pkt[PRT1_PKT_LENGTH] - 2;
+    
+    unsigned char data[dxl_sim_ax12::TableSize];
+    
+    // Instructions that only the broadcast ID receives, nobody answers
+    // but the BULK_READ servos, one after the other
+    if (id == BROADCAST_ID) {
+        if (inst == INST_ACTION) {
+            for (dxl_sim_ax12 &s : _servos) {
+                if (find(s.id()) == &s) s.action(end);
+            }
+        }
+        else if (inst == INST_SYNC_WRITE and n >= 2) {
+            int length = p[1];
+            for (int i = 2; i + length < n; i += length + 1) {
+                dxl_sim_ax12 *s = find(p[i]);
+                if (s != NULL) s->write(p[0], &p[i + 1], length, end);
+            }
+        }
+        else if (inst == INST_BULK_READ and n >= 1) {
+            qint64 t = end;
+            for (int i = 1; i + 2 < n; i += 3) {
+                dxl_sim_ax12 *s = find(p[i + 1]);
+                if (s == NULL) continue;
+                
+                int length = p[i];
+                int error = s->read(p[i + 2], length, data, t);
+                t = reply(s, error, data, error ? 0 : length, t);
+            }
+        }
+        return;
+    }
+    
+    dxl_sim_ax12 *s = find(id);
+    if (s == NULL) return;
+    
+    int error = 0;
+    int length = 0;
+    int level = 2;
+    switch (inst) {
+    case INST_PING:
+        level = 0;
+        break;
+    case INST_READ:
+        level = 1;
+        if (n < 2) error = SIM_ERR_INSTRUCTION;
+        else {
+            error = s->read(p[0], p[1], data, end);
+            if (error == 0) length = p[1];
+        }
+        break;
+    case INST_WRITE:
+        if (n < 1) error = SIM_ERR_INSTRUCTION;
+        else error = s->write(p[0], &p[1], n - 1, end);
+        break;
+    case INST_REG_WRITE:
+        if (n < 1) error = SIM_ERR_INSTRUCTION;
+        else error = s->reg_write(p[0], &p[1], n - 1);
+        break;
+    case INST_ACTION:
+        s->action(end);
+        break;
+    case INST_RESET:
+        s->reset();
+        break;
+    default:
+        error = SIM_ERR_INSTRUCTION;
+        break;
+    }
+    
+    // A servo with a new ID or baud rate answers with the new ones
+    if (s->status_level() >= level) reply(s, error, data, length, end);
+}
+
+qint64 dxl_port_sim::reply(dxl_sim_ax12 *servo, int error,
+                           const unsigned char *param, int n, qint64 ns)
+{
+    unsigned char pkt[MAXNUM_RXPACKET];
+    int len = _proto.make_packet(pkt, MAXNUM_RXPACKET, servo->id(), error,
+                                 param, n);
+    
+    answer a = { ns + servo->return_delay(), QByteArray((const char*)pkt, len),
+                 0 };
+    _rx.append(a);
+    
+    _busFree = qMax(_busFree, a.start + len*_byteTime);
+    return _busFree;
+}
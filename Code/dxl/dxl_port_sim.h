@@ -0,0 +1,102 @@
+/// @file dxl_port_sim.h Contains the dxl_port_sim class declaration
+#ifndef _DYNAMIXEL_PORT_SIM_HEADER
+#define _DYNAMIXEL_PORT_SIM_HEADER
+
+#include "dxl_port.h"
+#include "dxl_protocol1.h"
+#include "dxl_sim_ax12.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/// Simulated bus of AX-12 servos that answers Protocol 1.0 instructions
+/// (PING, READ, WRITE, REG_WRITE, ACTION, RESET, SYNC_WRITE and BULK_READ)
+/// without any hardware. The bus is half duplex, every byte takes 10 bits
+/// at the baud rate and every servo waits its return delay time before
+/// answering, so the transactions take the time they take on the robot.
+/// The servos only hear the packets sent at their baud rate.
+///
+/// The device name is the list of servo IDs separated by commas, the IDs
+/// 1 to 4 if it's empty. The servos start at the center position with the
+/// baud rate the port is opened with, or the one given as "id/baud", like
+/// "1,2,3,4,7/57600".
+class dxl_port_sim : public dxl_port {
+private:
+    
+    /// Bytes sent by a servo
+    struct answer {
+        qint64 start;       ///< Time in ns when the first byte is sent
+        QByteArray data;    ///< Bytes
+        int pos;            ///< Bytes already read
+    };
+    
+    /// Packet format
+    dxl_protocol1 _proto;
+    
+    /// Simulated servos
+    QVector<dxl_sim_ax12> _servos;
+    
+    /// True if the port is open
+    bool _open = false;
+    
+    /// Baud rate of the port
+    int _baudrate = 1000000;
+    
+    /// Time in ns to send a byte
+    qint64 _byteTime = 10000;
+    
+    /// Time in ns when the bus is free again
+    qint64 _busFree = 0;
+    
+    /// Sent bytes of an instruction not complete yet
+    QByteArray _tx;
+    
+    /// Answers not read yet
+    QList<answer> _rx;
+    
+    /// Returns the servo with the ID that hears the current baud rate, NULL
+    /// if there isn't any
+    dxl_sim_ax12* find(int id);
+    
+    /// Executes an instruction packet
+    /// @param pkt Contains the packet
+    /// @param end Time in ns when the last byte has been received
+    void execute(const unsigned char *pkt, qint64 end);
+    
+    /// Sends a status packet
+    /// @param servo Servo that answers
+    /// @param error Error byte
+    /// @param param Contains the parameters
+    /// @param n Number of parameters
+    /// @param ns Time in ns when the instruction has been received
+    /// @return Time in ns when the status packet has been sent
+    qint64 reply(dxl_sim_ax12 *servo, int error, const unsigned char *param,
+                 int n, qint64 ns);
+    
+    /// Returns the time in ns when the next answer byte can be read
+    /// @pre There are answers
+    inline qint64 next_byte() const
+    {
+        const answer &a = _rx.first();
+        return a.start + (a.pos + 1)*_byteTime;
+    }
+    
+public:
+    
+    bool open(const QString &device, int baudrate);
+    void close();
+    bool isOpen() const { return _open; }
+    void clear();
+    bool set_baudrate(int baudrate);
+    int write(const unsigned char *data, int n);
+    int read(unsigned char *data, int n);
+    bool wait(int usec);
+    
+    /// The bytes are delivered when they arrive, but the timeouts count
+    /// neither the instruction bytes nor the return delay time, so they
+    /// are given as latency
+    double latency() const;
+};
+
+#endif
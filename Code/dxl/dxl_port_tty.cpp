@@ -0,0 +1,194 @@
+/// @file dxl_port_tty.cpp Contains the dxl_port_tty class implementation
+#include "dxl_port_tty.h"
+
+#ifdef Q_OS_LINUX
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    
+/// Standard baud rates that termios can set directly
+struct baud_speed {
+    int baud;
+    speed_t speed;
+};
+    
+const baud_speed speeds[] = {
+    { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 },
+    { 57600, B57600 }, { 115200, B115200 }, { 230400, B230400 },
+    { 460800, B460800 }, { 500000, B500000 }, { 576000, B576000 },
+    { 921600, B921600 }, { 1000000, B1000000 }, { 1152000, B1152000 },
+    { 1500000, B1500000 }, { 2000000, B2000000 }, { 2500000, B2500000 },
+    { 3000000, B3000000 }
+};
+    
+}
+
+bool dxl_port_tty::open(const QString &device, int baudrate)
+{
+    close();
+    
+    // QSerialPortInfo gives the names without the directory
+    QString path = device.startsWith('/') ? device : "/dev/" + device;
+    _fd = ::open(path.toLocal8Bit().constData(),
+                 O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (_fd < 0) return false;
+    
+    // Raw 8N1 without flow control. The reads never block (VMIN = 0 and
+    // VTIME = 0), the waits are done with poll() because VTIME has 0.1 s
+    // resolution, far longer than a status packet
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) < 0) {
+        close();
+        return false;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | CRTSCTS);
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    if (tcsetattr(_fd, TCSANOW, &tio) < 0 or not set_baudrate(baudrate)) {
+        close();
+        return false;
+    }
+    
+    // The writes block until the bytes are queued in the driver
+    fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) & ~O_NONBLOCK);
+    
+    set_low_latency(path);
+    tcflush(_fd, TCIOFLUSH);
+    return true;
+}
+
+void dxl_port_tty::close()
+{
+    if (_fd < 0) return;
+    ::close(_fd);
+    _fd = -1;
+}
+
+void dxl_port_tty::clear()
+{
+    if (_fd >= 0) tcflush(_fd, TCIOFLUSH);
+}
+
+bool dxl_port_tty::set_baudrate(int baudrate)
+{
+    if (_fd < 0) return false;
+    
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) < 0) return false;
+    
+    struct serial_struct ss;
+    bool serial = ioctl(_fd, TIOCGSERIAL, &ss) == 0;
+    
+    speed_t speed = 0;
+    for (const baud_speed &s : speeds) if (s.baud == baudrate) speed = s.speed;
+    
+    if (speed != 0) {
+        // Removes a previous custom divisor
+        if (serial and (ss.flags & ASYNC_SPD_MASK) == ASYNC_SPD_CUST) {
+            ss.flags &= ~ASYNC_SPD_MASK;
+            ss.custom_divisor = 0;
+            ioctl(_fd, TIOCSSERIAL, &ss);
+        }
+    }
+    else {
+        // Rates like the 117647 and 400000 bps of the AX-12 need a custom
+        // divisor, then B38400 selects it
+        if (not serial or ss.baud_base <= 0 or baudrate <= 0) return false;
+        ss.flags = (ss.flags & ~ASYNC_SPD_MASK) | ASYNC_SPD_CUST;
+        ss.custom_divisor = (ss.baud_base + baudrate/2) / baudrate;
+        if (ss.custom_divisor == 0 or ioctl(_fd, TIOCSSERIAL, &ss) < 0)
+            return false;
+        speed = B38400;
+    }
+    
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    return tcsetattr(_fd, TCSANOW, &tio) == 0;
+}
+
+void dxl_port_tty::set_low_latency(const QString &device)
+{
+    struct serial_struct ss;
+    bool low = false;
+    if (ioctl(_fd, TIOCGSERIAL, &ss) == 0) {
+        ss.flags |= ASYNC_LOW_LATENCY;
+        low = ioctl(_fd, TIOCSSERIAL, &ss) == 0;
+    }
+    
+    // FTDI adapters keep the received bytes up to latency_timer ms, the low
+    // latency flag sets it to 1 ms in recent kernels and in older ones it's
+    // written here if there's permission
+    QFile timer("/sys/class/tty/" + QFileInfo(device).fileName() +
+                "/device/latency_timer");
+    if (timer.open(QIODevice::ReadOnly)) {
+        int ms = timer.readAll().trimmed().toInt();
+        timer.close();
+        if (ms > 1 and timer.open(QIODevice::WriteOnly)) {
+            if (timer.write("1") > 0) ms = 1;
+            timer.close();
+        }
+        if (ms > 0) {
+            _latency = ms;
+            return;
+        }
+    }
+    
+    // Without a latency timer the driver delivers the bytes at once in low
+    // latency mode, otherwise the USB adapters default is kept
+    _latency = low ? 1.0 : 16.0;
+}
+
+int dxl_port_tty::write(const unsigned char *data, int n)
+{
+    if (_fd < 0) return -1;
+    
+    int sent = 0;
+    while (sent < n) {
+        ssize_t k = ::write(_fd, data + sent, n - sent);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            return sent > 0 ? sent : -1;
+        }
+        sent += int(k);
+    }
+    return sent;
+}
+
+int dxl_port_tty::read(unsigned char *data, int n)
+{
+    if (_fd < 0) return -1;
+    
+    ssize_t k = ::read(_fd, data, n);
+    if (k < 0) return (errno == EAGAIN or errno == EINTR) ? 0 : -1;
+    return int(k);
+}
+
+bool dxl_port_tty::wait(int usec)
+{
+    if (_fd < 0) return false;
+    
+    struct pollfd fd;
+    fd.fd = _fd;
+    fd.events = POLLIN;
+    fd.revents = 0;
+    
+    struct timespec ts;
+    ts.tv_sec = usec > 0 ? usec / 1000000 : 0;
+    ts.tv_nsec = usec > 0 ? (usec % 1000000) * 1000 : 0;
+    
+    return ppoll(&fd, 1, &ts, NULL) > 0 and (fd.revents & POLLIN);
+}
+
+#endif
@@ -0,0 +1,44 @@
+/// @file dxl_port_tty.h Contains the dxl_port_tty class declaration
+#ifndef _DYNAMIXEL_PORT_TTY_HEADER
+#define _DYNAMIXEL_PORT_TTY_HEADER
+
+#include "dxl_port.h"
+
+#ifdef Q_OS_LINUX
+
+/// Native Linux serial port using termios directly. The tty is in raw mode
+/// and the driver is asked to deliver the received bytes as soon as they
+/// arrive (ASYNC_LOW_LATENCY and the FTDI latency timer), so a transaction
+/// doesn't wait for the 16 ms USB latency timer of the adapters.
+class dxl_port_tty : public dxl_port {
+private:
+    
+    /// File descriptor, -1 if the port is closed
+    int _fd = -1;
+    
+    /// Latency in ms
+    double _latency = 16.0;
+    
+    /// Sets the low latency mode and finds the adapter latency
+    /// @param device Device path
+    void set_low_latency(const QString &device);
+    
+public:
+    
+    /// Default destructor
+    ~dxl_port_tty() { close(); }
+    
+    bool open(const QString &device, int baudrate);
+    void close();
+    bool isOpen() const { return _fd >= 0; }
+    void clear();
+    bool set_baudrate(int baudrate);
+    int write(const unsigned char *data, int n);
+    int read(unsigned char *data, int n);
+    bool wait(int usec);
+    double latency() const { return _latency; }
+};
+
+#endif
+
+#endif
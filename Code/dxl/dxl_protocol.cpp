@@ -0,0 +1,11 @@
+/// @file dxl_protocol.cpp Contains the dxl_protocol class implementation
+#include "dxl_protocol.h"
+#include "dxl_protocol1.h"
+#include "dxl_protocol2.h"
+
+dxl_protocol* dxl_protocol::create(int version)
+{
+    if (version == 1) return new dxl_protocol1();
+    if (version == 2) return new dxl_protocol2();
+    return NULL;
+}
@@ -0,0 +1,92 @@
+/// @file dxl_protocol.h Contains the dxl_protocol class declaration
+#ifndef _DYNAMIXEL_PROTOCOL_HEADER
+#define _DYNAMIXEL_PROTOCOL_HEADER
+
+#include "dxl_hal.h"
+
+/// Decoded status packet
+struct dxl_status {
+    int id = 0;         ///< ID of the servo that sent it
+    int error = 0;      ///< Error byte
+    int length = 0;     ///< Number of parameters
+    
+    /// Parameters, without any byte stuffing
+    unsigned char param[MAXNUM_RXPACKET] = {0};
+};
+
+/// Dynamixel packet format, it builds the instruction packets and checks and
+/// decodes the status packets. The instruction codes are the same in both 
+/// protocol versions, only the packet format and the address and length 
+/// parameters change.
+class dxl_protocol {
+public:
+    
+    /// Default destructor
+    virtual ~dxl_protocol() {}
+    
+    /// Returns a new protocol of the selected version, NULL if it's unknown
+    /// @param version 1 for Protocol 1.0 and 2 for Protocol 2.0
+    static dxl_protocol* create(int version);
+    
+    /// Returns the protocol version, 1 or 2
+    virtual int version() const = 0;
+    
+    /// Returns true if the instruction exists in this protocol
+    virtual bool is_supported(int inst) const = 0;
+    
+    /// Builds an instruction packet
+    /// @param pkt Stores the packet
+    /// @param size Size of pkt
+    /// @param id Destination ID
+    /// @param inst Instruction
+    /// @param param Contains the parameters
+    /// @param n Number of parameters
+    /// @return Length of the packet, 0 if it doesn't fit
+    virtual int make_packet(unsigned char *pkt, int size, int id, int inst, 
+                            const unsigned char *param, int n) const = 0;
+    
+    /// Writes a control table address as a parameter
+    /// @return Number of bytes used
+    virtual int put_address(unsigned char *p, int address) const = 0;
+    
+    /// Writes a data length as a parameter
+    /// @return Number of bytes used
+    virtual int put_length(unsigned char *p, int length) const = 0;
+    
+    /// Returns the number of parameters of the status packet answering an
+    /// instruction
+    virtual int status_params(int inst, const unsigned char *param, 
+                              int n) const = 0;
+    
+    /// Returns the length of a status packet, without byte stuffing
+    /// @param n Number of parameters
+    virtual int status_length(int n) const = 0;
+    
+    /// Returns the number of bytes needed to know the packet length
+    virtual int header_length() const = 0;
+    
+    /// Returns the position of the first packet header, if there isn't any
+    /// the position where a partially received one could start
+    virtual int find_header(const unsigned char *buf, int len) const = 0;
+    
+    /// Returns the length of the packet at the start of buf
+    /// @pre buf starts with a header
+    /// @return Packet length, 0 if not enough bytes have been received
+    virtual int packet_length(const unsigned char *buf, int len) const = 0;
+    
+    /// Checks a whole status packet without decoding it
+    /// @param buf Contains the packet
+    /// @param len Packet length
+    /// @return True if the length and checksum are correct
+    virtual bool check(const unsigned char *buf, int len) const = 0;
+    
+    /// Checks and decodes a whole status packet
+    /// @param buf Contains the packet
+    /// @param len Packet length
+    /// @param st Stores the decoded packet
+    /// @return True if the packet is correct
+    virtual bool parse(const unsigned char *buf, int len, 
+                       dxl_status &st) const = 0;
+};
+
+#endif
@@ -0,0 +1,101 @@
+/// @file dxl_protocol1.cpp Contains the dxl_protocol1 class implementation
+#include "dxl_protocol1.h"
+#include "dynamixel.h"
+
+#include <cstring>
+
+bool dxl_protocol1::is_supported(int inst) const
+{
+    switch (inst) {
+    case INST_PING:
+    case INST_READ:
+    case INST_WRITE:
+    case INST_REG_WRITE:
+    case INST_ACTION:
+    case INST_RESET:
+    case INST_SYNC_WRITE:
+    case INST_BULK_READ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int dxl_protocol1::make_packet(unsigned char *pkt, int size, int id, int inst,
+                               const unsigned char *param, int n) const
+{
+    if (n + 6 > size or n + 2 > 0xFF) return 0;
+    
+    pkt[0] = 0xFF;
+    pkt[1] = 0xFF;
+    pkt[PRT1_PKT_ID] = (unsigned char)id;
+    pkt[PRT1_PKT_LENGTH] = (unsigned char)(n + 2);
+    pkt[PRT1_PKT_INSTRUCTION] = (unsigned char)inst;
+    memcpy(&pkt[PRT1_PKT_PARAMETER0], param, n);
+    
+    unsigned char checksum = 0;
+    for (int i = PRT1_PKT_ID; i < PRT1_PKT_PARAMETER0 + n; ++i) {
+        checksum += pkt[i];
+    }
+    pkt[PRT1_PKT_PARAMETER0 + n] = ~checksum;
+    return n + 6;
+}
+
+int dxl_protocol1::put_address(unsigned char *p, int address) const
+{
+    p[0] = (unsigned char)address;
+    return 1;
+}
+
+int dxl_protocol1::put_length(unsigned char *p, int length) const
+{
+    p[0] = (unsigned char)length;
+    return 1;
+}
+
+int dxl_protocol1::status_params(int inst, const unsigned char *param, 
+                                 int n) const
+{
+    if (inst == INST_READ and n >= 2) return param[1];
+    return 0;
+}
+
+int dxl_protocol1::find_header(const unsigned char *buf, int len) const
+{
+    for (int i = 0; i + 1 < len; ++i) {
+        if (buf[i] != 0xFF or buf[i + 1] != 0xFF) continue;
+        
+        // The ID is never 0xFF, so extra 0xFF bytes are skipped
+        while (i + 2 < len and buf[i + 2] == 0xFF) ++i;
+        return i;
+    }
+    if (len > 0 and buf[len - 1] == 0xFF) return len - 1;
+    return len;
+}
+
+int dxl_protocol1::packet_length(const unsigned char *buf, int len) const
+{
+    if (len < header_length()) return 0;
+    return buf[PRT1_PKT_LENGTH] + 4;
+}
+
+bool dxl_protocol1::check(const unsigned char *buf, int len) const
+{
+    if (len < 6 or len != packet_length(buf, len)) return false;
+    
+    unsigned char checksum = 0;
+    for (int i = PRT1_PKT_ID; i < len - 1; ++i) checksum += buf[i];
+    return (unsigned char)~checksum == buf[len - 1];
+}
+
+bool dxl_protocol1::parse(const unsigned char *buf, int len, 
+                          dxl_status &st) const
+{
+    if (not check(buf, len)) return false;
+    
+    st.id = buf[PRT1_PKT_ID];
+    st.error = buf[PRT1_PKT_ERRBIT];
+    st.length = len - 6;
+    memcpy(st.param, &buf[PRT1_PKT_PARAMETER0], st.length);
+    return true;
+}
@@ -0,0 +1,26 @@
+/// @file dxl_protocol1.h Contains the dxl_protocol1 class declaration
+#ifndef _DYNAMIXEL_PROTOCOL1_HEADER
+#define _DYNAMIXEL_PROTOCOL1_HEADER
+
+#include "dxl_protocol.h"
+
+/// Dynamixel Protocol 1.0, 0xFF 0xFF header, one byte length and addresses
+/// and an 8 bit checksum
+class dxl_protocol1 : public dxl_protocol {
+public:
+    int version() const { return 1; }
+    bool is_supported(int inst) const;
+    int make_packet(unsigned char *pkt, int size, int id, int inst, 
+                    const unsigned char *param, int n) const;
+    int put_address(unsigned char *p, int address) const;
+    int put_length(unsigned char *p, int length) const;
+    int status_params(int inst, const unsigned char *param, int n) const;
+    int status_length(int n) const { return n + 6; }
+    int header_length() const { return 4; }
+    int find_header(const unsigned char *buf, int len) const;
+    int packet_length(const unsigned char *buf, int len) const;
+    bool check(const unsigned char *buf, int len) const;
+    bool parse(const unsigned char *buf, int len, dxl_status &st) const;
+};
+
+#endif
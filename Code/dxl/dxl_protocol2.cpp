@@ -0,0 +1,154 @@
+/// @file dxl_protocol2.cpp Contains the dxl_protocol2 class implementation
+#include "dxl_protocol2.h"
+#include "dynamixel.h"
+
+namespace {
+
+/// Packet header
+const unsigned char header[4] = { 0xFF, 0xFF, 0xFD, 0x00 };
+
+/// CRC16 lookup table, polynomial 0x8005 without reflection
+struct crc_table {
+    unsigned short t[256];
+    
+    crc_table()
+    {
+        for (int i = 0; i < 256; ++i) {
+            unsigned short c = i << 8;
+            for (int j = 0; j < 8; ++j) {
+                c = (c & 0x8000) ? (c << 1) ^ 0x8005 : (c << 1);
+            }
+            t[i] = c;
+        }
+    }
+};
+
+}
+
+unsigned short dxl_protocol2::crc(const unsigned char *data, int n, 
+                                  unsigned short crc)
+{
+    static const crc_table table;
+    for (int i = 0; i < n; ++i) {
+        crc = (crc << 8) ^ table.t[((crc >> 8) ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+bool dxl_protocol2::is_supported(int inst) const
+{
+    switch (inst) {
+    case INST_PING:
+    case INST_READ:
+    case INST_WRITE:
+    case INST_REG_WRITE:
+    case INST_ACTION:
+    case INST_RESET:
+    case INST_SYNC_READ:
+    case INST_SYNC_WRITE:
+    case INST_FAST_SYNC_READ:
+    case INST_BULK_READ:
+        return true;
+    default:
+        return false;
+    }
+}
+
+int dxl_protocol2::make_packet(unsigned char *pkt, int size, int id, int inst,
+                               const unsigned char *param, int n) const
+{
+    if (size < 10) return 0;
+    
+    for (int i = 0; i < 4; ++i) pkt[i] = header[i];
+    pkt[PRT2_PKT_ID] = (unsigned char)id;
+    pkt[PRT2_PKT_INSTRUCTION] = (unsigned char)inst;
+    
+    // Byte stuffing, a 0xFD is added after every 0xFF 0xFF 0xFD so the 
+    // header never appears inside the packet
+    int k = PRT2_PKT_PARAMETER0;
+    for (int i = 0; i < n; ++i) {
+        if (k + 4 > size) return 0;
+        pkt[k++] = param[i];
+        if (param[i] == 0xFD and pkt[k - 2] == 0xFF and pkt[k - 3] == 0xFF
+            and k - 3 > PRT2_PKT_INSTRUCTION) pkt[k++] = 0xFD;
+    }
+    
+    int length = k - PRT2_PKT_INSTRUCTION + 2;
+    if (length > 0xFFFF) return 0;
+    pkt[PRT2_PKT_LENGTH_L] = LOBYTE(length);
+    pkt[PRT2_PKT_LENGTH_H] = HIBYTE(length);
+    
+    unsigned short c = crc(pkt, k);
+    pkt[k++] = LOBYTE(c);
+    pkt[k++] = HIBYTE(c);
+    return k;
+}
+
+int dxl_protocol2::put_address(unsigned char *p, int address) const
+{
+    p[0] = LOBYTE(address);
+    p[1] = HIBYTE(address);
+    return 2;
+}
+
+int dxl_protocol2::put_length(unsigned char *p, int length) const
+{
+    p[0] = LOBYTE(length);
+    p[1] = HIBYTE(length);
+    return 2;
+}
+
+int dxl_protocol2::status_params(int inst, const unsigned char *param, 
+                                 int n) const
+{
+    // Model number and firmware version
+    if (inst == INST_PING) return 3;
+    if (inst == INST_READ and n >= 4) return MAKEWORD(param[2], param[3]);
+    return 0;
+}
+
+int dxl_protocol2::find_header(const unsigned char *buf, int len) const
+{
+    for (int i = 0; i < len; ++i) {
+        int j = 0;
+        while (j < 4 and i + j < len and buf[i + j] == header[j]) ++j;
+        
+        // Whole header or the start of one at the end of the buffer
+        if (j == 4 or i + j == len) return i;
+    }
+    return len;
+}
+
+int dxl_protocol2::packet_length(const unsigned char *buf, int len) const
+{
+    if (len < header_length()) return 0;
+    return MAKEWORD(buf[PRT2_PKT_LENGTH_L], buf[PRT2_PKT_LENGTH_H]) + 7;
+}
+
+bool dxl_protocol2::check(const unsigned char *buf, int len) const
+{
+    if (len < 11 or len != packet_length(buf, len)) return false;
+    if (buf[PRT2_PKT_INSTRUCTION] != INST_STATUS) return false;
+    
+    unsigned short c = crc(buf, len - 2);
+    return c == MAKEWORD(buf[len - 2], buf[len - 1]);
+}
+
+bool dxl_protocol2::parse(const unsigned char *buf, int len, 
+                          dxl_status &st) const
+{
+    if (not check(buf, len)) return false;
+    
+    st.id = buf[PRT2_PKT_ID];
+    st.error = buf[PRT2_PKT_ERRBIT];
+    
+    // Removes the byte stuffing
+    int k = 0;
+    for (int i = PRT2_PKT_ERRBIT + 1; i < len - 2; ++i) {
+        if (buf[i] == 0xFD and buf[i - 1] == 0xFD and buf[i - 2] == 0xFF 
+            and buf[i - 3] == 0xFF) continue;
+        st.param[k++] = buf[i];
+    }
+    st.length = k;
+    return true;
+}
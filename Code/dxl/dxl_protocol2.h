@@ -0,0 +1,31 @@
+/// @file dxl_protocol2.h Contains the dxl_protocol2 class declaration
+#ifndef _DYNAMIXEL_PROTOCOL2_HEADER
+#define _DYNAMIXEL_PROTOCOL2_HEADER
+
+#include "dxl_protocol.h"
+
+/// Dynamixel Protocol 2.0, 0xFF 0xFF 0xFD 0x00 header, two byte length and
+/// addresses, byte stuffing and CRC16
+class dxl_protocol2 : public dxl_protocol {
+public:
+    int version() const { return 2; }
+    bool is_supported(int inst) const;
+    int make_packet(unsigned char *pkt, int size, int id, int inst, 
+                    const unsigned char *param, int n) const;
+    int put_address(unsigned char *p, int address) const;
+    int put_length(unsigned char *p, int length) const;
+    int status_params(int inst, const unsigned char *param, int n) const;
+    int status_length(int n) const { return n + 11; }
+    int header_length() const { return 7; }
+    int find_header(const unsigned char *buf, int len) const;
+    int packet_length(const unsigned char *buf, int len) const;
+    bool check(const unsigned char *buf, int len) const;
+    bool parse(const unsigned char *buf, int len, dxl_status &st) const;
+    
+    /// Returns the CRC16 (polynomial 0x8005) of the data
+    /// @param crc Initial value, used to continue a previous CRC
+    static unsigned short crc(const unsigned char *data, int n, 
+                              unsigned short crc = 0);
+};
+
+#endif
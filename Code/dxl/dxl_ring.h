@@ -0,0 +1,69 @@
+/// @file dxl_ring.h Contains the dxl_ring class declaration and
+/// implementation
+#ifndef _DYNAMIXEL_RING_HEADER
+#define _DYNAMIXEL_RING_HEADER
+
+/// Fixed size byte ring buffer used to store the received bytes until
+/// they are consumed by the packet layer. The size must be a power of 2.
+template<int N>
+class dxl_ring {
+private:
+    
+    /// Contains the stored bytes
+    unsigned char _buf[N];
+    
+    /// Position of the first byte
+    unsigned int _head = 0;
+    
+    /// Position after the last byte
+    unsigned int _tail = 0;
+    
+public:
+    
+    /// Returns the number of stored bytes
+    inline int size() const { return int(_tail - _head); }
+    
+    /// Returns the number of bytes that can be added
+    inline int free() const { return N - size(); }
+    
+    /// True if there are no bytes
+    inline bool empty() const { return _tail == _head; }
+    
+    /// Removes all the bytes
+    inline void clear() { _head = _tail = 0; }
+    
+    /// Returns the byte at the selected position from the first one
+    inline unsigned char operator[](int i) const 
+    { 
+        return _buf[(_head + i) & (N - 1)]; 
+    }
+    
+    /// Adds bytes at the end, the ones that don't fit are discarded
+    /// @return Number of bytes added
+    int push(const unsigned char *data, int n)
+    {
+        if (n > free()) n = free();
+        for (int i = 0; i < n; ++i) _buf[(_tail + i) & (N - 1)] = data[i];
+        _tail += n;
+        return n;
+    }
+    
+    /// Removes bytes from the beginning and copies them to data
+    /// @return Number of bytes removed
+    int pop(unsigned char *data, int n)
+    {
+        if (n > size()) n = size();
+        for (int i = 0; i < n; ++i) data[i] = _buf[(_head + i) & (N - 1)];
+        _head += n;
+        return n;
+    }
+    
+    /// Discards bytes from the beginning
+    inline void skip(int n)
+    {
+        if (n > size()) n = size();
+        _head += n;
+    }
+};
+
+#endif
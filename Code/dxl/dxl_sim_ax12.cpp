@@ -0,0 +1,210 @@
+/// @file dxl_sim_ax12.cpp Contains the dxl_sim_ax12 class implementation
+#include "dxl_sim_ax12.h"
+#include "ax12.h"
+
+#include <cmath>
+#include <cstring>
+
+/// Steps per second of a MovingSpeed unit (0.111 rpm, 1024 steps in 300º)
+#define SIM_SPEED_UNIT      (0.111*360.0/60.0*1024.0/300.0)
+
+/// MovingSpeed of the motor without load at 12 V, also used when the
+/// register is 0
+#define SIM_SPEED_MAX       (1023)
+
+/// Acceleration in steps/s² with the robot arms, a rough estimate
+#define SIM_ACCEL           (20000.0)
+
+/// Longest motion integration step in ns
+#define SIM_STEP            (1000000)
+
+/// Range error bit of the error byte
+#define SIM_ERR_RANGE       (8)
+
+/// Factory values of the control table, the ID and the baud rate are set
+/// by the constructor
+static const unsigned char gFactory[dxl_sim_ax12::TableSize] = {
+    12, 0, 24, 1, 34, 250, 0, 0, 0xFF, 0x03,        // 0 - 9
+    0, 70, 60, 140, 0xFF, 0x03, 2, 36, 36, 0,       // 10 - 19
+    0, 0, 0, 0, 0, 0, 1, 1, 32, 32,                 // 20 - 29
+    0, 0, 0, 0, 0xFF, 0x03, 0, 0, 0, 0,             // 30 - 39
+    0, 0, 120, 40, 0, 0, 0, 0, 32, 0                // 40 - 49
+};
+
+/// Returns true if the address can be written, the same addresses as
+/// AX12::isWritable()
+static bool is_writable(int address)
+{
+    if (address >= AX12::ID and address <= AX12::AlarmShutdown)
+        return address != 10;
+    if (address >= AX12::TorqueEnable and address < AX12::PresentPosition)
+        return true;
+    return address >= AX12::Lock and address < dxl_sim_ax12::TableSize;
+}
+
+dxl_sim_ax12::dxl_sim_ax12(int id, int baudrate, int position) :
+    _pos(position),
+    _speed(0.0),
+    _time(0),
+    _regAddress(0),
+    _regLength(0)
+{
+    std::memcpy(_table, gFactory, TableSize);
+    _table[AX12::ID] = uchar(id);
+    _table[AX12::BaudRate] = uchar(qBound(0, 2000000/baudrate - 1, 254));
+    set_word(AX12::GoalPosition, position);
+    publish();
+}
+
+void dxl_sim_ax12::reset()
+{
+    // The EEPROM and the RAM go back to the factory values, the motor stays
+    // where it is
+    std::memcpy(_table, gFactory, TableSize);
+    set_word(AX12::GoalPosition, qRound(_pos));
+    _speed = 0.0;
+    _regLength = 0;
+    publish();
+}
+
+int dxl_sim_ax12::id() const
+{
+    return _table[AX12::ID];
+}
+
+int dxl_sim_ax12::baudrate() const
+{
+    return 2000000/(_table[AX12::BaudRate] + 1);
+}
+
+qint64 dxl_sim_ax12::return_delay() const
+{
+    return qint64(_table[AX12::ReturnDelayTime])*2000;
+}
+
+int dxl_sim_ax12::status_level() const
+{
+    return _table[AX12::StatusReturnLevel];
+}
+
+int dxl_sim_ax12::read(int address, int length, unsigned char *data, qint64 ns)
+{
+    if (address < 0 or length < 0 or address + length > TableSize)
+        return SIM_ERR_RANGE;
+    
+    update(ns);
+    std::memcpy(data, &_table[address], length);
+    return 0;
+}
+
+int dxl_sim_ax12::write(int address, const unsigned char *data, int length,
+                        qint64 ns)
+{
+    if (address < 0 or length < 0 or address + length > TableSize)
+        return SIM_ERR_RANGE;
+    
+    update(ns);
+    
+    // The EEPROM can't be written while the lock is set
+    bool locked = _table[AX12::Lock] != 0;
+    for (int i = 0; i < length; ++i) {
+        int a = address + i;
+        if (not is_writable(a)) continue;
+        if (locked and a < AX12::TorqueEnable) continue;
+        _table[a] = data[i];
+    }
+    
+    // A new goal turns the torque on
+    if (address <= AX12::GoalPosition + 1 and
+        address + length > AX12::GoalPosition)
+        _table[AX12::TorqueEnable] = 1;
+    return 0;
+}
+
+int dxl_sim_ax12::reg_write(int address, const unsigned char *data, int length)
+{
+    if (address < 0 or length < 0 or address + length > TableSize)
+        return SIM_ERR_RANGE;
+    
+    std::memcpy(_reg, data, length);
+    _regAddress = address;
+    _regLength = length;
+    _table[AX12::Registered] = 1;
+    return 0;
+}
+
+void dxl_sim_ax12::action(qint64 ns)
+{
+    if (_regLength == 0) return;
+    
+    write(_regAddress, _reg, _regLength, ns);
+    _regLength = 0;
+    _table[AX12::Registered] = 0;
+}
+
+void dxl_sim_ax12::update(qint64 ns)
+{
+    if (_time == 0 or ns <= _time) {
+        _time = qMax(_time, ns);
+        return;
+    }
+    
+    int lo = word(AX12::CWAngleLimit);
+    int hi = word(AX12::CCWAngleLimit);
+    double goal = qBound(lo, word(AX12::GoalPosition), qMax(lo, hi));
+    
+    int speed = word(AX12::MovingSpeed) & 0x3FF;
+    if (speed == 0 or speed > SIM_SPEED_MAX) speed = SIM_SPEED_MAX;
+    double vMax = speed*SIM_SPEED_UNIT;
+    
+    for (qint64 t = _time; t < ns; t += SIM_STEP) {
+        double dt = qMin(ns - t, qint64(SIM_STEP))*1e-9;
+        
+        // Full speed outside the slope, then slower as it gets closer, and
+        // stopped inside the margin. A free motor stops by friction
+        double error = goal - _pos;
+        double target = 0.0;
+        if (_table[AX12::TorqueEnable] != 0) {
+            bool ccw = error > 0;
+            double margin = _table[ccw ? AX12::CCWComplianceMargin :
+                                         AX12::CWComplianceMargin];
+            double slope = qMax(1, int(_table[ccw ? AX12::CCWComplianceSlope :
+                                                    AX12::CWComplianceSlope]));
+            double left = std::fabs(error) - margin;
+            if (left > 0) target = vMax*qMin(1.0, left/slope)*(ccw ? 1 : -1);
+        }
+        
+        // Nothing changes once it's at rest
+        if (target == 0.0 and _speed == 0.0) break;
+        
+        double dv = SIM_ACCEL*dt;
+        _speed = qBound(_speed - dv, target, _speed + dv);
+        
+        // It doesn't overshoot the goal
+        double step = _speed*dt;
+        if (error != 0.0 and step/error > 1.0) {
+            step = error;
+            _speed = 0.0;
+        }
+        _pos = qBound(0.0, _pos + step, 1023.0);
+    }
+    _time = ns;
+    publish();
+}
+
+void dxl_sim_ax12::publish()
+{
+    set_word(AX12::PresentPosition, qRound(_pos));
+    
+    // The direction is the bit 10, set when turning clockwise
+    int speed = qMin(qRound(std::fabs(_speed)/SIM_SPEED_UNIT), 1023);
+    set_word(AX12::PresentSpeed, speed | (_speed < 0 ? 0x400 : 0));
+    
+    int lo = word(AX12::CWAngleLimit);
+    int hi = word(AX12::CCWAngleLimit);
+    int goal = qBound(lo, word(AX12::GoalPosition), qMax(lo, hi));
+    int margin = _table[goal > _pos ? AX12::CCWComplianceMargin :
+                                      AX12::CWComplianceMargin];
+    bool moving = _speed != 0.0 or std::fabs(goal - _pos) > margin + 0.5;
+    _table[AX12::Moving] = moving and _table[AX12::TorqueEnable] != 0;
+}
@@ -0,0 +1,96 @@
+/// @file dxl_sim_ax12.h Contains the dxl_sim_ax12 class declaration
+#ifndef _DYNAMIXEL_SIM_AX12_HEADER
+#define _DYNAMIXEL_SIM_AX12_HEADER
+
+#include <QtGlobal>
+
+/// Simulated AX-12 servo used by the "sim:" port. It has the control table
+/// of the AX-12 (see AX12::ROM and AX12::RAM) with the factory values, and
+/// the present position follows the goal position with the moving speed,
+/// the compliance margins and slopes and a limited acceleration. The motion
+/// is advanced when the servo is accessed, so an idle bus costs nothing.
+class dxl_sim_ax12 {
+public:
+    
+    /// Size of the control table
+    static const int TableSize = 50;
+    
+    /// Initialization constructor, the control table has the factory values
+    /// @param id Servo ID
+    /// @param baudrate Baud rate in bps
+    /// @param position Initial present position
+    dxl_sim_ax12(int id = 1, int baudrate = 1000000, int position = 512);
+    
+    /// Restores the factory values, the RESET instruction. The ID is 1 and
+    /// the baud rate 1 Mbps, the position doesn't change
+    void reset();
+    
+    /// Returns the ID
+    int id() const;
+    
+    /// Returns the baud rate in bps
+    int baudrate() const;
+    
+    /// Returns the time in ns the servo waits before answering
+    qint64 return_delay() const;
+    
+    /// Returns the status return level, 0 answers only PING, 1 only READ
+    /// and 2 all the instructions
+    int status_level() const;
+    
+    /// Reads control table bytes
+    /// @param ns Time in ns, the motion is advanced until it
+    /// @return Error byte, the range error bit if they're outside the table
+    int read(int address, int length, unsigned char *data, qint64 ns);
+    
+    /// Writes control table bytes, the read only ones are ignored
+    /// @param ns Time in ns, the motion is advanced until it
+    /// @return Error byte, the range error bit if they're outside the table
+    int write(int address, const unsigned char *data, int length, qint64 ns);
+    
+    /// Registers a write until action(), the REG_WRITE instruction
+    /// @return Error byte, the range error bit if they're outside the table
+    int reg_write(int address, const unsigned char *data, int length);
+    
+    /// Executes the registered write, if any
+    void action(qint64 ns);
+    
+private:
+    
+    /// Control table
+    unsigned char _table[TableSize];
+    
+    /// Position in steps, with the fraction the registers don't show
+    double _pos;
+    
+    /// Speed in steps/s, positive counter clockwise
+    double _speed;
+    
+    /// Time in ns of the last motion update
+    qint64 _time;
+    
+    /// Registered write, its address and length
+    unsigned char _reg[TableSize];
+    int _regAddress, _regLength;
+    
+    /// Returns a word of the control table
+    inline int word(int address) const
+    {
+        return _table[address] | _table[address + 1] << 8;
+    }
+    
+    /// Sets a word of the control table
+    inline void set_word(int address, int value)
+    {
+        _table[address] = uchar(value & 0xFF);
+        _table[address + 1] = uchar(value >> 8);
+    }
+    
+    /// Advances the motion until the time
+    void update(qint64 ns);
+    
+    /// Updates the present position, speed and moving registers
+    void publish();
+};
+
+#endif
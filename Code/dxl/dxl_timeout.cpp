@@ -0,0 +1,97 @@
+/// @file dxl_timeout.cpp Contains the dxl_timeout class implementation
+#include "dxl_timeout.h"
+
+#include <cmath>
+
+/// Weight of a new time in the moving averages
+#define TIMEOUT_EWMA_GAIN   (0.125)
+
+/// Timeouts in a row between every fixed timeout
+#define TIMEOUT_PROBE       (16)
+
+int dxl_timeout::bin(double ms)
+{
+    double us = ms*1000.0;
+    if (us <= 1.0) return 0;
+    int b = int(std::ceil(std::log2(us)*BinsPerOctave));
+    return qMin(b, Bins - 1);
+}
+
+double dxl_timeout::bin_time(int bin)
+{
+    return std::exp2(double(bin)/BinsPerOctave) / 1000.0;
+}
+
+double dxl_timeout::percentile(const entry &e, double p)
+{
+    int limit = int(std::ceil(e.total*p));
+    int sum = 0;
+    for (int i = 0; i < Bins; ++i) {
+        sum += e.bins[i];
+        if (sum >= limit) return bin_time(i);
+    }
+    return bin_time(Bins - 1);
+}
+
+double dxl_timeout::timeout(int id, int inst, double fixed)
+{
+    entry &e = _entries[id << 8 | inst];
+    
+    // A servo that stops answering could only be slower, so sometimes it's
+    // given the whole fixed time
+    bool probe = e.misses > 0 and e.misses % TIMEOUT_PROBE == 0;
+    
+    if (not _enabled or e.timing.count < _warmup or probe) {
+        e.timing.timeout = fixed;
+    }
+    else {
+        double t = qMax(e.timing.p99, e.timing.mean + 4.0*e.timing.dev);
+        e.timing.timeout = qMax(_min, t*_margin);
+    }
+    return e.timing.timeout;
+}
+
+void dxl_timeout::add(int id, int inst, double ms)
+{
+    entry &e = _entries[id << 8 | inst];
+    dxl_timing &t = e.timing;
+    if (ms < 0.0) ms = 0.0;
+    
+    if (t.count == 0) {
+        t.mean = ms;
+        t.dev = ms/2.0;
+    }
+    else {
+        double err = ms - t.mean;
+        t.mean += TIMEOUT_EWMA_GAIN*err;
+        t.dev += TIMEOUT_EWMA_GAIN*(std::fabs(err) - t.dev);
+    }
+    ++t.count;
+    e.misses = 0;
+    
+    // The histogram forgets the old times halving the counts
+    if (e.total == 1024) {
+        e.total = 0;
+        for (unsigned short &b : e.bins) {
+            b /= 2;
+            e.total += b;
+        }
+    }
+    ++e.bins[bin(ms)];
+    ++e.total;
+    
+    t.p50 = percentile(e, 0.5);
+    t.p99 = percentile(e, 0.99);
+}
+
+void dxl_timeout::miss(int id, int inst)
+{
+    entry &e = _entries[id << 8 | inst];
+    ++e.timing.timeouts;
+    ++e.misses;
+}
+
+dxl_timing dxl_timeout::get(int id, int inst) const
+{
+    return _entries.value(id << 8 | inst).timing;
+}
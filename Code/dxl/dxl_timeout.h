@@ -0,0 +1,110 @@
+/// @file dxl_timeout.h Contains the dxl_timeout class declaration
+#ifndef _DYNAMIXEL_TIMEOUT_HEADER
+#define _DYNAMIXEL_TIMEOUT_HEADER
+
+#include <QHash>
+
+/// Response time statistics of one servo and instruction, the times don't
+/// include the transmission of the status packet bytes
+struct dxl_timing {
+    int count = 0;          ///< Status packets received
+    int timeouts = 0;       ///< Status packets not received
+    double mean = 0.0;      ///< Moving average of the response time in ms
+    double dev = 0.0;       ///< Moving average of the deviation in ms
+    double p50 = 0.0;       ///< Median response time in ms
+    double p99 = 0.0;       ///< 99th percentile of the response time in ms
+    double timeout = 0.0;   ///< Last waiting time used in ms
+};
+
+/// Receive timeouts computed from the measured response times of every
+/// servo and instruction. The time between the instruction and its status
+/// packet is tracked with a moving average and a histogram, and the timeout
+/// is the 99th percentile (or the average plus four deviations if it's
+/// longer) multiplied by a safety margin. Until enough answers are received
+/// the fixed timeout is used, so is every few timeouts in a row to find a
+/// servo that has become slower.
+class dxl_timeout {
+private:
+    
+    /// Histogram bins per octave
+    static const int BinsPerOctave = 4;
+    
+    /// Histogram bins, from 1 µs to about 1 s
+    static const int Bins = 20*BinsPerOctave;
+    
+    /// Statistics of a servo and instruction
+    struct entry {
+        dxl_timing timing;
+        
+        /// Response times histogram, the counts are halved when they
+        /// reach the maximum so the old times are forgotten
+        unsigned short bins[Bins] = {0};
+        
+        /// Sum of the histogram counts
+        int total = 0;
+        
+        /// Timeouts in a row
+        int misses = 0;
+    };
+    
+    /// Statistics by (ID << 8 | instruction)
+    QHash<int, entry> _entries;
+    
+    /// Multiplies the measured response time
+    double _margin = 1.5;
+    
+    /// Minimum waiting time in ms
+    double _min = 0.2;
+    
+    /// Answers needed before using the measured times
+    int _warmup = 8;
+    
+    /// False to always use the fixed timeout
+    bool _enabled = true;
+    
+    /// Returns the histogram bin of a time in ms
+    static int bin(double ms);
+    
+    /// Returns the longest time in ms of a histogram bin
+    static double bin_time(int bin);
+    
+    /// Returns the time in ms below the selected fraction of the answers
+    static double percentile(const entry &e, double p);
+    
+public:
+    
+    /// Returns the waiting time for a status packet
+    /// @param id Servo ID
+    /// @param inst Instruction sent
+    /// @param fixed Fixed waiting time in ms used without statistics
+    /// @return Waiting time in ms, without the status packet bytes time
+    double timeout(int id, int inst, double fixed);
+    
+    /// Adds a received status packet
+    /// @param ms Response time in ms, without the status packet bytes time
+    void add(int id, int inst, double ms);
+    
+    /// Adds a status packet not received
+    void miss(int id, int inst);
+    
+    /// Returns the statistics of a servo and instruction
+    dxl_timing get(int id, int inst) const;
+    
+    /// Clears all the statistics
+    inline void reset() { _entries.clear(); }
+    
+    /// Returns the safety margin
+    inline double get_margin() const { return _margin; }
+    
+    /// Sets the safety margin that multiplies the measured response time
+    /// @param margin Margin, at least 1
+    inline void set_margin(double margin) { _margin = qMax(1.0, margin); }
+    
+    /// True if the measured times are used
+    inline bool is_enabled() const { return _enabled; }
+    
+    /// Selects if the measured times are used or the fixed timeout
+    inline void set_enabled(bool enabled) { _enabled = enabled; }
+};
+
+#endif
@@ -3,15 +3,54 @@
 
 #include "dynamixel.h"
 
-#define LATENCY_TIME		(16) //ms (USB2Dynamixel Default Latency Time)
-#define PING_STATUS_LENGTH  (14)
+/// Group reads in a row without any answer, while the servos answer single
+/// reads, until a slower group read is used
+#define GROUP_READ_MISSES   (3)
 
+/// Reads with a degraded group read until the fastest one is tested again
+#define GROUP_READ_PROBE    (1000)
 
-dynamixel::dynamixel(QString port_num, int baud_rate)
+
+dynamixel::dynamixel(int protocol)
+{
+    set_protocol(protocol);
+    if (gProtocol == NULL) set_protocol(1);
+}
+
+dynamixel::dynamixel(QString port_num, int baud_rate, int protocol) :
+    dynamixel(protocol)
 {
     initialize(port_num, baud_rate);
 }
 
+dynamixel::~dynamixel()
+{
+    dH.close();
+    delete gProtocol;
+}
+
+void dynamixel::set_protocol(int protocol)
+{
+    if (gProtocol != NULL and gProtocol->version() == protocol) return;
+    
+    dxl_protocol *p = dxl_protocol::create(protocol);
+    if (p == NULL) return;
+    
+    delete gProtocol;
+    gProtocol = p;
+    gParser.set_protocol(gProtocol);
+    
+    // Every protocol starts with its fastest group read
+    reset_group_read();
+}
+
+void dynamixel::reset_group_read()
+{
+    giGroupRead = fastest_group_read();
+    giGroupMisses = 0;
+    giGroupProbe = 0;
+}
+
 int dynamixel::initialize( QString port_num, int baud_rate )
 {
 	if( baud_rate < 1900 ) return 0;
@@ -20,6 +59,7 @@ int dynamixel::initialize( QString port_num, int baud_rate )
     
     // 1000/baudrate(bit per msec) * 10(start bit + data bit + stop bit)
 	gdByteTransTime = 1000.0 / (double)baud_rate * 10.0; 
+	giBaudRate = baud_rate;
 
 	gbCommStatus = COMM_RXSUCCESS;
 	giBusUsing = 0;
@@ -33,12 +73,32 @@ int dynamixel::change_baudrate(int baud_rate )
     float baudrate = (float)baud_rate;
     
     result = dH.change_baudrate(baudrate);
-    if(result == 1)
+    if(result == 1) {
         gdByteTransTime = 1000.0f / baudrate * 10.0; // 1000/baudrate(bit per msec) * 10(start bit + data bit + stop bit)
+        giBaudRate = baud_rate;
+    }
 
     return result;
 }
 
+dynamixel::settings dynamixel::save()
+{
+    settings s;
+    s.baudrate = giBaudRate;
+    s.protocol = gProtocol->version();
+    s.groupRead = giGroupRead;
+    s.latency = dH.get_latency_setting();
+    return s;
+}
+
+void dynamixel::restore(const settings &s)
+{
+    if (s.baudrate != giBaudRate) change_baudrate(s.baudrate);
+    set_protocol(s.protocol);
+    giGroupRead = GroupRead(s.groupRead);
+    dH.set_latency(s.latency);
+}
+
 int dynamixel::terminate(void)
 {
 	dH.close();
@@ -48,20 +108,28 @@ int dynamixel::terminate(void)
 ////////////// methods for timeout //////////////
 double dynamixel::get_packet_time(void)
 {
-	double elapsed_time;
-
-    elapsed_time = (double)(dH.get_curr_time() - gdPacketStartTime);
-
-    // Overflow
-    if(elapsed_time < 0) gdPacketStartTime = dH.get_curr_time();
-	
-	return elapsed_time;
+    // Monotonic clock, it can't overflow or go backwards
+    return (dH.get_curr_time() - gdPacketStartTime) / 1000000.0;
 }
 
 void dynamixel::set_packet_timeout(int NumRcvByte)
+{
+	// The clock has ns resolution so no extra margin for its granularity 
+	// is needed
+	gdPacketStartTime = dH.get_curr_time();
+	// The adapter latency is added for the instruction and the status
+	gdRcvWaitTime = (gdByteTransTime*(double)NumRcvByte + 2.0*dH.get_latency());
+	giRxId = -1;
+}
+
+void dynamixel::set_status_timeout(int id, int instruction, int NumRcvByte)
 {
 	gdPacketStartTime = dH.get_curr_time();
-	gdRcvWaitTime = (gdByteTransTime*(double)NumRcvByte + 2.0*LATENCY_TIME + 2.0);
+	gdRxBytesTime = gdByteTransTime*(double)NumRcvByte;
+	gdRcvWaitTime = gdTxBytesTime + gdRxBytesTime + 
+		gTimeout.timeout( id, instruction, 2.0*dH.get_latency() );
+	giRxId = id;
+	giRxInstruction = instruction;
 }
 
 void dynamixel::set_packet_timeout_ms(int msec)
@@ -77,46 +145,61 @@ bool dynamixel::is_packet_timeout(void)
     return false;
 }
 
-///////// 1.0 packet communocation method /////////
+void dynamixel::reset_latency()
+{
+    gLatency = dxl_latency();
+}
+
+void dynamixel::update_latency(qint64 ns)
+{
+    if (ns < 0) ns = 0;
+    
+    gLatency.last = ns;
+    if (gLatency.count == 0 or ns < gLatency.min) gLatency.min = ns;
+    if (ns > gLatency.max) gLatency.max = ns;
+    ++gLatency.count;
+    gLatency.mean += (ns - gLatency.mean) / double(gLatency.count);
+}
+
+///////// packet communication methods /////////
+void dynamixel::set_packet(int id, int instruction)
+{
+    giTxId = id;
+    giTxInstruction = instruction;
+    giTxLength = 0;
+}
+
 void dynamixel::tx_packet(void)
 {
-	unsigned char pkt_idx = 0;
-	unsigned char TxNumByte, RealTxNumByte;
-	unsigned char checksum = 0;
+	int TxNumByte, RealTxNumByte;
 
-	if( giBusUsing == 1 )
+	// A status packet still expected is abandoned, the bus is already owned
+	// by this thread (dxl_bus) and the parser skips its late bytes
+	giBusUsing = 1;
+	
+	if( not gProtocol->is_supported(giTxInstruction) )
 	{
-		gbCommStatus = COMM_TXFAIL;
+		gbCommStatus = COMM_TXERROR;
+		giBusUsing = 0;
 		return;
 	}
 	
-	giBusUsing = 1;
-	
-	if( gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_PING
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_READ
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_WRITE
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_REG_WRITE
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_ACTION
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_RESET
-		&& gbInstructionPacket[PRT1_PKT_INSTRUCTION] != INST_SYNC_WRITE )
+	TxNumByte = gProtocol->make_packet( gbInstructionPacket, MAXNUM_TXPACKET, 
+	                                    giTxId, giTxInstruction, 
+	                                    gbTxParameter, giTxLength );
+	if( TxNumByte == 0 )
 	{
 		gbCommStatus = COMM_TXERROR;
 		giBusUsing = 0;
 		return;
 	}
-	
-	gbInstructionPacket[0] = 0xff;
-	gbInstructionPacket[1] = 0xff;
-	for( pkt_idx = 0; pkt_idx < (gbInstructionPacket[PRT1_PKT_LENGTH]+1); pkt_idx++ )
-		checksum += gbInstructionPacket[pkt_idx+2];
-	gbInstructionPacket[gbInstructionPacket[PRT1_PKT_LENGTH]+3] = ~checksum;
-	
-	//if( gbCommStatus == COMM_RXTIMEOUT || gbCommStatus == COMM_RXCORRUPT )
-	//	dH.clear();
 
-	dH.clear();
+	// Complete packets received before the instruction are late answers,
+	// they are discarded without flushing the port. The bytes of an 
+	// incomplete one are skipped by the parser when the answer arrives
+	rx_fill();
+	gParser.discard();
 
-	TxNumByte = gbInstructionPacket[PRT1_PKT_LENGTH] + 4;
 	RealTxNumByte = dH.write( gbInstructionPacket, TxNumByte );
 
 	if( TxNumByte != RealTxNumByte )
@@ -126,112 +209,104 @@ void dynamixel::tx_packet(void)
 		return;
 	}
 
-	if( gbInstructionPacket[PRT1_PKT_INSTRUCTION] == INST_READ )
-	{
-		gbRxPacketLength =  gbInstructionPacket[PRT1_PKT_PARAMETER0+1] + 6;
-		set_packet_timeout( gbInstructionPacket[PRT1_PKT_PARAMETER0+1] + 6 );
-	}
-	else
-	{
-		gbRxPacketLength = 6;
-		set_packet_timeout( 6 );
-	}
+	gdTxBytesTime = gdByteTransTime*(double)TxNumByte;
+	gbRxPacketLength = gProtocol->status_length( 
+		gProtocol->status_params(giTxInstruction, gbTxParameter, giTxLength) );
+	set_status_timeout( giTxId, giTxInstruction, gbRxPacketLength );
 
 	gbCommStatus = COMM_TXSUCCESS;
 }
 
 void dynamixel::rx_packet(void)
 {
-	unsigned char i = 0, j = 0, nRead = 0;
-	unsigned char checksum = 0;
-
 	if( giBusUsing == 0 )
 		return;
 
-	if( gbInstructionPacket[PRT1_PKT_ID] == BROADCAST_ID )
+	if( giTxId == BROADCAST_ID )
 	{
 		gbCommStatus = COMM_RXSUCCESS;
 		giBusUsing = 0;
 		return;
 	}
 	
-	if( gbCommStatus == COMM_TXSUCCESS )
+	rx_status( giTxId );
+}
+
+int dynamixel::rx_fill()
+{
+	unsigned char buf[RX_RING_SIZE];
+	int total = 0;
+	int nRead;
+
+	// The bytes that don't fit wait in the port until the packets are taken
+	while( gParser.free() > 0 and
+	       (nRead = dH.read( buf, qMin(RX_RING_SIZE, gParser.free()) )) > 0 )
 	{
-		gbRxGetLength = 0;
-		//gbRxPacketLength = 6; //minimum wait length
+		gParser.feed( buf, nRead );
+		total += nRead;
 	}
+	return total;
+}
+
+void dynamixel::rx_status(int id)
+{
+	if( gbCommStatus == COMM_TXSUCCESS )
+		gbRxGetLength = 0;
 	
 	while(1)
 	{
-		nRead = dH.read( &gbStatusPacket[gbRxGetLength], gbRxPacketLength - gbRxGetLength );
-		gbRxGetLength += nRead;
-
-		if(gbRxGetLength > 4)
-			gbRxPacketLength = gbStatusPacket[PRT1_PKT_LENGTH] + 4;
-
-		if( gbRxGetLength < gbRxPacketLength )
+		// The waiting packets are taken in order, the ones from other IDs
+		// are late answers
+		while( gParser.next( gStatus ) )
 		{
-			if( is_packet_timeout() == 1 )
+			if( id != gStatus.id )
+				continue;
+			
+			// A packet of a group read that was received while waiting for
+			// the previous one has no response time of its own, its bytes 
+			// arrived before this wait started
+			gdRxPacketTime = dH.get_rx_time();
+			if( gbRxGetLength > 0 )
 			{
-				if(gbRxGetLength == 0)
-					gbCommStatus = COMM_RXTIMEOUT;
-				else
-					gbCommStatus = COMM_RXCORRUPT;
-				giBusUsing = 0;
-				return;
+				update_latency( gdRxPacketTime - gdPacketStartTime );
+				if( giRxId >= 0 )
+					gTimeout.add( giRxId, giRxInstruction, 
+					              (gdRxPacketTime - gdPacketStartTime)/1000000.0 - 
+					              gdTxBytesTime - gdRxBytesTime );
 			}
-			gbCommStatus = COMM_RXWAITING;
-			//return;			
+			
+			// The next status packets of a group read don't wait for the
+			// instruction
+			gdTxBytesTime = 0.0;
+			
+			gbCommStatus = COMM_RXSUCCESS;
+			giBusUsing = 0;
+			return;
 		}
-		else
+
+		int nRead = rx_fill();
+		if( nRead > 0 )
 		{
-			break;
+			gbRxGetLength += nRead;
+			continue;
 		}
-	}
 
-	// Find packet header
-	for( i=0; i<(gbRxGetLength-1); i++ )
-	{
-		if( gbStatusPacket[i] == 0xff && gbStatusPacket[i+1] == 0xff )
-			break;
-		else if( i == gbRxGetLength-2 && gbStatusPacket[gbRxGetLength-1] == 0xff )
-			break;
-		else {
-			gbCommStatus = COMM_RXCORRUPT;
+		if( is_packet_timeout() == 1 )
+		{
+			if(gbRxGetLength == 0)
+				gbCommStatus = COMM_RXTIMEOUT;
+			else
+				gbCommStatus = COMM_RXCORRUPT;
+			if( giRxId >= 0 )
+				gTimeout.miss( giRxId, giRxInstruction );
+			giBusUsing = 0;
 			return;
 		}
+		gbCommStatus = COMM_RXWAITING;
+		
+		// Sleeps until more bytes arrive or the packet times out
+		dH.wait( int((gdRcvWaitTime - get_packet_time())*1000.0) );
 	}
-
-	if( i > 0 )
-	{
-		for( j=0; j<(gbRxGetLength-i); j++ )
-			gbStatusPacket[j] = gbStatusPacket[j + i];
-			
-		gbRxGetLength -= i;		
-	}
-
-	// Check id pairing
-	if( gbInstructionPacket[PRT1_PKT_ID] != gbStatusPacket[PRT1_PKT_ID])
-	{
-		gbCommStatus = COMM_RXCORRUPT;
-		giBusUsing = 0;
-		return;
-	}
-	
-	// Check checksum
-	for( i=0; i<(gbStatusPacket[PRT1_PKT_LENGTH]+1); i++ )
-		checksum += gbStatusPacket[i+2];
-	checksum = ~checksum;
-
-	if( gbStatusPacket[gbStatusPacket[PRT1_PKT_LENGTH]+3] != checksum )
-	{
-		gbCommStatus = COMM_RXCORRUPT;
-		giBusUsing = 0;
-		return;
-	}
-	
-	gbCommStatus = COMM_RXSUCCESS;
-	giBusUsing = 0;
 }
 
 void dynamixel::txrx_packet(void)
@@ -248,112 +323,281 @@ void dynamixel::txrx_packet(void)
 ////////////// get/set packet methods /////////////
 void dynamixel::set_txpacket_id(int id)
 {
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
+	giTxId = id;
 }
 
 void dynamixel::set_txpacket_instruction(int instruction)
 {
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = (unsigned char)instruction;
+	giTxInstruction = instruction;
 }
 
 void dynamixel::set_txpacket_parameter(int index, int value)
 {
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+index] = (unsigned char)value;
+	gbTxParameter[index] = (unsigned char)value;
 
 }
 
 void dynamixel::set_txpacket_length(int length)
 {
-	gbInstructionPacket[PRT1_PKT_LENGTH] = (unsigned char)length;
+	giTxLength = qBound(0, length - 2, MAXNUM_TXPACKET);
 }
 
 bool  dynamixel::get_rxpacket_error(int error)
 {
-	if( gbStatusPacket[PRT1_PKT_ERRBIT] & (unsigned char)error )
-		return true;
-
-	return false;
+	if( gProtocol->version() == 1 )
+		return gStatus.error & error;
+	
+	// Protocol 2.0 has an alert bit and an error number
+	if( error == ERRBIT_ALERT )
+		return gStatus.error & ERRBIT_ALERT;
+	
+	return (gStatus.error & ~ERRBIT_ALERT) == error;
 }
 
 int dynamixel::get_rxpacket_error_byte(void)
 {
-	return gbStatusPacket[PRT1_PKT_ERRBIT];
+	return gStatus.error;
 }
 
 int  dynamixel::get_rxpacket_parameter( int index )
 {
-	return (int)gbStatusPacket[PRT1_PKT_PARAMETER0+index];
+	return (int)gStatus.param[index];
 }
 
 int  dynamixel::get_rxpacket_length()
 {
-	return (int)gbStatusPacket[PRT1_PKT_LENGTH];
+	return gStatus.length + 2;
 }
 
-void dynamixel::ping( int id )
+int dynamixel::status_value(int index, int length)
 {
-	while(giBusUsing);
+    int value = 0;
+    for (int i = length - 1; i >= 0; --i) {
+        value = (value << 8) | gStatus.param[index + i];
+    }
+    return value;
+}
 
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = INST_PING;
-	gbInstructionPacket[PRT1_PKT_LENGTH] = 2;
+void dynamixel::ping( int id )
+{
+	set_packet( id, INST_PING );
 	
 	txrx_packet();
 }
 
-int dynamixel::read_byte( int id, int address )
+bool dynamixel::identify(int id, int &model, int &firmware)
 {
-	while(giBusUsing);
+    model = -1;
+    firmware = -1;
+    
+    ping(id);
+    if (gbCommStatus != COMM_RXSUCCESS) return false;
+    
+    if (gProtocol->version() == 2) {
+        if (gStatus.length >= 3) {
+            model = status_value(0, 2);
+            firmware = status_value(2, 1);
+        }
+        return true;
+    }
+    
+    // A READ of the model number and the firmware at address 0, every 
+    // servo answers it unlike the group reads
+    int data = read_data(id, 0, 3);
+    if (gbCommStatus == COMM_RXSUCCESS) {
+        model = data & 0xFFFF;
+        firmware = data >> 16;
+    }
+    return true;
+}
 
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = INST_READ;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+0] = (unsigned char)address;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+1] = 1;
-	gbInstructionPacket[PRT1_PKT_LENGTH] = 4;
+int dynamixel::read_data( int id, int address, int length )
+{
+	set_packet( id, INST_READ );
+	add_address( address );
+	add_length( length );
 	
 	txrx_packet();
 
-	return (int)gbStatusPacket[PRT1_PKT_PARAMETER0];
+	return status_value( 0, length );
 }
 
-void dynamixel::write_byte( int id, int address, int value )
+int dynamixel::read_byte( int id, int address )
 {
-	while(giBusUsing);
+	return read_data( id, address, 1 );
+}
 
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = INST_WRITE;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+0] = (unsigned char)address;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+1] = (unsigned char)value;
-	gbInstructionPacket[PRT1_PKT_LENGTH] = 4;
+void dynamixel::write_byte( int id, int address, int value )
+{
+	set_packet( id, INST_WRITE );
+	add_address( address );
+	add_byte( value );
 	
 	txrx_packet();
 }
 
 int dynamixel::read_word( int id, int address )
 {
-	while(giBusUsing);
+	return read_data( id, address, 2 );
+}
 
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = INST_READ;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+0] = (unsigned char)address;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+1] = 2;
-	gbInstructionPacket[PRT1_PKT_LENGTH] = 4;
+void dynamixel::write_word( int id, int address, int value )
+{
+	set_packet( id, INST_WRITE );
+	add_address( address );
+	add_byte( LOBYTE(value) );
+	add_byte( HIBYTE(value) );
 	
 	txrx_packet();
+}
 
-	return MAKEWORD((int)gbStatusPacket[PRT1_PKT_PARAMETER0+0], (int)gbStatusPacket[PRT1_PKT_PARAMETER0+1]);
+int dynamixel::bulk_read_word(const QVector<int> &ID, int address, 
+                              QVector<int> &value, QVector<double> &time)
+{
+    return sync_read(ID, address, 2, value, time);
 }
 
-void dynamixel::write_word( int id, int address, int value )
+int dynamixel::sync_read(const QVector<int> &ID, int address, int length,
+                         QVector<int> &value, QVector<double> &time)
 {
-	while(giBusUsing);
+    int n = ID.size();
+    value.fill(-1, n);
+    time.fill(0.0, n);
+    if (n == 0) return 0;
+    
+    // A degraded group read could come from servos that were powering up
+    // or from noise, the fastest one is tested again now and then
+    if (giGroupRead != fastest_group_read() and 
+        ++giGroupProbe >= GROUP_READ_PROBE) {
+        reset_group_read();
+    }
+    
+    // Servos without any group read support are read one by one
+    if (giGroupRead == GroupSingle) 
+        return single_read(ID, address, length, value, time);
+    
+    if (giGroupRead == GroupBulk) {
+        set_packet(BROADCAST_ID, INST_BULK_READ);
+        add_byte(0);
+        for (int i = 0; i < n; ++i) {
+            add_byte(length);
+            add_byte(ID[i]);
+            add_address(address);
+        }
+    }
+    else {
+        set_packet(BROADCAST_ID, giGroupRead == GroupFastSync ? 
+                       INST_FAST_SYNC_READ : INST_SYNC_READ);
+        add_address(address);
+        add_length(length);
+        for (int i = 0; i < n; ++i) add_byte(ID[i]);
+    }
+    
+    tx_packet();
+    if (gbCommStatus != COMM_TXSUCCESS) return 0;
+    
+    int read = 0;
+    if (giGroupRead == GroupFastSync) {
+        // A single status packet from the broadcast ID, every servo adds 
+        // its ID, data and CRC and the error byte of the next one
+        int stride = length + 4;
+        gbCommStatus = COMM_TXSUCCESS;
+        gbRxPacketLength = gProtocol->status_length((n - 1)*stride + length + 1);
+        set_status_timeout(BROADCAST_ID, INST_FAST_SYNC_READ, gbRxPacketLength);
+        
+        rx_status(BROADCAST_ID);
+        if (gbCommStatus == COMM_RXSUCCESS 
+            and gStatus.length == (n - 1)*stride + length + 1) {
+            for (int i = 0; i < n; ++i) {
+                if (gStatus.param[i*stride] != ID[i]) continue;
+                value[i] = status_value(i*stride + 1, length);
+                time[i] = gdRxPacketTime / 1000000.0;
+                ++read;
+            }
+        }
+    }
+    else {
+        // Every servo answers after the previous one, so a missing status 
+        // packet means that the following servos won't answer either
+        for (int i = 0; i < n; ++i) {
+            giBusUsing = 1;
+            gbCommStatus = COMM_TXSUCCESS;
+            gbRxPacketLength = gProtocol->status_length(length);
+            set_status_timeout(ID[i], giTxInstruction, gbRxPacketLength);
+            
+            rx_status(ID[i]);
+            if (gbCommStatus != COMM_RXSUCCESS) break;
+            
+            value[i] = status_value(0, length);
+            time[i] = gdRxPacketTime / 1000000.0;
+            ++read;
+        }
+    }
+    giBusUsing = 0;
+    
+    if (read > 0 or gbCommStatus != COMM_RXTIMEOUT) {
+        if (read > 0) giGroupMisses = 0;
+        return read;
+    }
+    
+    // Nothing received, the first servo could have missed its status packet
+    // and stopped the others. They're read one by one, and only if the first
+    // one answers that way the servos are taken as not knowing the 
+    // instruction, an absent servo isn't a missing group read
+    read = single_read(ID, address, length, value, time);
+    if (time[0] > 0.0 and ++giGroupMisses >= GROUP_READ_MISSES) {
+        giGroupRead = (giGroupRead == GroupFastSync) ? GroupSync : GroupSingle;
+        giGroupMisses = 0;
+        giGroupProbe = 0;
+    }
+    
+    return read;
+}
 
-	gbInstructionPacket[PRT1_PKT_ID] = (unsigned char)id;
-	gbInstructionPacket[PRT1_PKT_INSTRUCTION] = INST_WRITE;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+0] = (unsigned char)address;
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+1] = (unsigned char)LOBYTE(value);
-	gbInstructionPacket[PRT1_PKT_PARAMETER0+2] = (unsigned char)HIBYTE(value);
-	gbInstructionPacket[PRT1_PKT_LENGTH] = 5;
-	
-	txrx_packet();
+int dynamixel::single_read(const QVector<int> &ID, int address, int length,
+                           QVector<int> &value, QVector<double> &time)
+{
+    int read = 0;
+    for (int i = 0; i < ID.size(); ++i) {
+        int data = read_data(ID[i], address, length);
+        if (gbCommStatus != COMM_RXSUCCESS) continue;
+        value[i] = data;
+        time[i] = gdRxPacketTime / 1000000.0;
+        ++read;
+    }
+    return read;
+}
+
+void dynamixel::reg_write(int id, int address, const QVector<int> &data)
+{
+    set_packet(id, INST_REG_WRITE);
+    add_address(address);
+    for (int i = 0; i < data.size(); ++i) add_byte(data[i]);
+    
+    txrx_packet();
+}
+
+void dynamixel::action(int id)
+{
+    set_packet(id, INST_ACTION);
+    
+    txrx_packet();
+}
+
+void dynamixel::sync_write(const QVector<int> &ID, int address, int length, 
+                           const QVector<int> &data)
+{
+    Q_ASSERT(data.size() == ID.size()*length);
+    int n = ID.size();
+    if (n == 0) return;
+    
+    set_packet(BROADCAST_ID, INST_SYNC_WRITE);
+    add_address(address);
+    add_length(length);
+    for (int i = 0; i < n; ++i) {
+        add_byte(ID[i]);
+        for (int j = 0; j < length; ++j) add_byte(data[i*length + j]);
+    }
+    
+    txrx_packet();
 }
@@ -4,6 +4,10 @@
 #define _DYNAMIXEL_HEADER
 
 #include "dxl_hal.h"
+#include "dxl_parser.h"
+#include "dxl_timeout.h"
+
+#include <QVector>
 
 #define MAX_ID				(252)
 #define BROADCAST_ID		(254)  //BroadCast ID
@@ -36,6 +40,13 @@
 #define PRT1_PKT_ERRBIT				(4)
 #define PRT1_PKT_PARAMETER0			(5)
 
+#define PRT2_PKT_ID					(4)
+#define PRT2_PKT_LENGTH_L			(5)
+#define PRT2_PKT_LENGTH_H			(6)
+#define PRT2_PKT_INSTRUCTION		(7)
+#define PRT2_PKT_ERRBIT				(8)
+#define PRT2_PKT_PARAMETER0			(8)
+
 
 #define INST_PING			(1)
 #define INST_READ			(2)
@@ -43,7 +54,10 @@
 #define INST_REG_WRITE		(4)
 #define INST_ACTION			(5)
 #define INST_RESET			(6)
+#define INST_STATUS         (85)   // 0x55, only protocol 2.0
+#define INST_SYNC_READ      (130)  // 0x82, only protocol 2.0
 #define INST_SYNC_WRITE		(131)
+#define INST_FAST_SYNC_READ (138)  // 0x8A, only protocol 2.0
 #define	INST_BULK_READ      (146)  // 0x92
 
 #define PING_INFO_MODEL_NUM   (1)
@@ -57,27 +71,77 @@
 #define LOBYTE(w)           ((unsigned char)(((unsigned long)(w)) & 0xff))
 #define HIBYTE(w)           ((unsigned char)((((unsigned long)(w)) >> 8) & 0xff))
 
-/// Dynamixel 1.0 protocol class
+/// Latency of the bus transactions, measured from the end of the instruction
+/// packet transmission to the reception of the whole status packet
+struct dxl_latency {
+    qint64 last = 0;    ///< Last transaction latency in ns
+    qint64 min = 0;     ///< Minimum latency in ns
+    qint64 max = 0;     ///< Maximum latency in ns
+    double mean = 0.0;  ///< Mean latency in ns
+    quint64 count = 0;  ///< Number of measured transactions
+};
+
+/// Dynamixel communication class, the packets format is given by the 
+/// selected protocol (1.0 or 2.0) so all the methods work with both of them.
+/// It isn't thread safe, the threads that use the same port share it with
+/// a dxl_bus
 class dynamixel {
+public:
+    
+    /// Bus settings that a client of a shared bus changes for a while, see
+    /// save() and restore()
+    struct settings {
+        int baudrate;       ///< Baud rate
+        int protocol;       ///< Protocol version, 1 or 2
+        int groupRead;      ///< Group read in use, it's learnt with the servos
+        double latency;     ///< Latency set with set_port_latency()
+    };
+    
 private:
     
+    /// Ways to read the same register of several servos
+    enum GroupRead {
+        GroupFastSync,  ///< One FAST_SYNC_READ status packet, only 2.0
+        GroupSync,      ///< SYNC_READ, a status packet per servo, only 2.0
+        GroupBulk,      ///< BULK_READ, a status packet per servo
+        GroupSingle     ///< A READ instruction per servo
+    };
+    
     /// Conains the serial port comunication
     dxl_hal dH;
     
-    /// Contains all the instructions
+    /// Packet format
+    dxl_protocol *gProtocol = NULL;
+    
+    /// Contains the instruction packet as it's sent
     unsigned char gbInstructionPacket[MAXNUM_TXPACKET] = {0};
     
-    /// Contains the status
-    unsigned char gbStatusPacket[MAXNUM_RXPACKET] = {0};
+    /// Instruction packet ID
+    int giTxId = 0;
+    
+    /// Instruction packet instruction
+    int giTxInstruction = 0;
+    
+    /// Instruction packet parameters
+    unsigned char gbTxParameter[MAXNUM_TXPACKET] = {0};
     
-    /// Received packet length
-    unsigned int gbRxPacketLength = 0;
+    /// Number of instruction packet parameters
+    int giTxLength = 0;
     
-    /// Temporal length from the received packet
-    unsigned int gbRxGetLength = 0;
+    /// Finds the status packets in the received bytes
+    dxl_parser gParser;
     
-    /// Packet start time
-    double gdPacketStartTime = 0.0;
+    /// Contains the last decoded status packet
+    dxl_status gStatus;
+    
+    /// Expected status packet length
+    int gbRxPacketLength = 0;
+    
+    /// Bytes received since the status packet was expected
+    int gbRxGetLength = 0;
+    
+    /// Packet start time in ns
+    qint64 gdPacketStartTime = 0;
     
     /// Byte transmission time
     double gdByteTransTime = 0.0;
@@ -85,22 +149,131 @@ private:
     /// Receive wait time
     double gdRcvWaitTime = 0.0;
     
+    /// Time in ns when the last status packet was completely received
+    qint64 gdRxPacketTime = 0;
+    
+    /// Contains the transactions latency
+    dxl_latency gLatency;
+    
+    /// Status packet timeouts from the measured response times
+    dxl_timeout gTimeout;
+    
+    /// ID of the expected status packet, -1 if it isn't measured
+    int giRxId = -1;
+    
+    /// Instruction answered by the expected status packet
+    int giRxInstruction = 0;
+    
+    /// Transmission time in ms of the expected status packet
+    double gdRxBytesTime = 0.0;
+    
+    /// Transmission time in ms of the last instruction packet, the port 
+    /// write returns when it's queued so the first status packet after it
+    /// waits for it too
+    double gdTxBytesTime = 0.0;
+    
     /// Current communication status
     int gbCommStatus = COMM_RXSUCCESS;
     
-    /// True if the bus if being used
+    /// True while a status packet is expected
     int giBusUsing = 0; 
     
+    /// Current baud rate
+    int giBaudRate = 0;
+    
+    /// Group read used, it's degraded if the servos don't answer it
+    GroupRead giGroupRead = GroupBulk;
+    
+    /// Group reads in a row that nobody answered while the servos answered
+    /// single reads
+    int giGroupMisses = 0;
+    
+    /// Group reads done since the group read was degraded
+    int giGroupProbe = 0;
+    
+    /// Starts a new instruction packet
+    void set_packet(int id, int instruction);
+    
+    /// Adds a parameter byte to the instruction packet
+    inline void add_byte(int value) 
+    { 
+        gbTxParameter[giTxLength++] = (unsigned char)value; 
+    }
+    
+    /// Adds a control table address to the instruction packet
+    inline void add_address(int address)
+    {
+        giTxLength += gProtocol->put_address(&gbTxParameter[giTxLength], address);
+    }
+    
+    /// Adds a data length to the instruction packet
+    inline void add_length(int length)
+    {
+        giTxLength += gProtocol->put_length(&gbTxParameter[giTxLength], length);
+    }
+    
+    /// Sets the timeout of a status packet from the response times measured
+    /// with the same ID and instruction
+    /// @param id ID that must send the status packet
+    /// @param instruction Instruction answered
+    /// @param NumRcvByte Status packet length
+    void set_status_timeout(int id, int instruction, int NumRcvByte);
+    
+    /// Reads up to 4 bytes from the selected ID
+    /// @return Little endian value
+    int read_data(int id, int address, int length);
+    
+    /// Reads the same register from all the selected IDs one by one, see
+    /// sync_read()
+    int single_read(const QVector<int> &ID, int address, int length,
+                    QVector<int> &value, QVector<double> &time);
+    
+    /// Returns the fastest group read of the protocol
+    inline GroupRead fastest_group_read()
+    {
+        return gProtocol->version() == 2 ? GroupFastSync : GroupBulk;
+    }
+    
+    /// Moves the bytes already received to the parser
+    /// @return Number of bytes moved
+    int rx_fill();
+    
+    /// Receives a status packet from the selected ID, the waiting packets
+    /// from other IDs are discarded
+    /// @param id ID that must have sent the status packet
+    void rx_status(int id);
+    
+    /// Returns the received value of the last status packet
+    /// @param index First parameter
+    /// @param length Number of bytes, up to 4
+    int status_value(int index, int length);
+    
+    /// Adds a new transaction latency to the statistics
+    /// @param ns Latency in ns
+    void update_latency(qint64 ns);
+    
+    Q_DISABLE_COPY(dynamixel)
+    
 public:
     
     /// Default constructor
-    dynamixel() {}
+    /// @param protocol Protocol version, 1 or 2
+    dynamixel(int protocol = 1);
     
     /// Initialization constructor
-    dynamixel(QString port_num, int baud_rate = 1000000);
+    /// @param protocol Protocol version, 1 or 2
+    dynamixel(QString port_num, int baud_rate = 1000000, int protocol = 1);
     
     /// Default destructor
-    ~dynamixel() { dH.close(); }
+    ~dynamixel();
+    
+    /// Returns the protocol version, 1 or 2
+    inline int get_protocol() { return gProtocol->version(); }
+    
+    /// Selects the protocol version
+    /// @param protocol 1 for Protocol 1.0 and 2 for Protocol 2.0, other 
+    /// values are ignored
+    void set_protocol(int protocol);
     
     /// True if the port is open
     inline bool isOpen() { return dH.isOpen(); }
@@ -111,6 +284,31 @@ public:
     /// Changes the current baud rate
     int change_baudrate(int baud_rate);
     
+    /// Returns the current baud rate
+    inline int get_baudrate() { return giBaudRate; }
+    
+    /// Returns the serial adapter latency in ms used in the timeouts
+    inline double get_port_latency() { return dH.get_latency(); }
+    
+    /// Sets the serial adapter latency used in the timeouts
+    /// @param msec Latency in ms, negative to use the one found when the
+    /// port is opened
+    inline void set_port_latency(double msec) { dH.set_latency(msec); }
+    
+    /// Returns the current bus settings
+    settings save();
+    
+    /// Restores the bus settings returned by save(), the group read learnt
+    /// isn't lost when the protocol has been changed meanwhile
+    void restore(const settings &s);
+    
+    /// Goes back to the fastest group read of the protocol, the servos are
+    /// tested again with it
+    void reset_group_read();
+    
+    /// Returns the faults injected by a "fault:" port, see dxl_port_fault
+    inline dxl_fault_stats get_faults() { return dH.get_faults(); }
+    
     /// Closes the comunication
     int terminate(void);
     
@@ -137,26 +335,78 @@ public:
     /// Sets the sending packet parameter
     void set_txpacket_parameter(int index, int value);
     
-    /// Sets the sending packet length
+    /// Sets the sending packet length, number of parameters + 2 like the 
+    /// protocol 1.0 LENGTH field with both protocols
     void set_txpacket_length(int length);
     
     /// Returns false if no receive error and true if there's an error
-    /// @param error Selects the error to check
+    /// @param error Selects the error to check, a bit with protocol 1.0 and
+    /// ERRBIT_ALERT or an error number with protocol 2.0
     bool get_rxpacket_error(int error);
     
     /// Returns the error byte
     int  get_rxpacket_error_byte(void);
     
-    /// Returns the received parameter
+    /// Returns the received parameter, without byte stuffing
     int  get_rxpacket_parameter( int index );
     
-    /// Returns the received packet length
+    /// Returns the received packet length, number of parameters + 2 like 
+    /// the protocol 1.0 LENGTH field
     int  get_rxpacket_length();
     
+    /// Returns the time in ns when the last status packet was received
+    inline qint64 get_rxpacket_time() { return gdRxPacketTime; }
+    
+    /// Returns the latency statistics of the received status packets
+    inline dxl_latency get_latency() { return gLatency; }
+    
+    /// Clears the latency statistics
+    void reset_latency();
+    
+    /// Returns the response time statistics and the last timeout used with
+    /// a servo and an instruction
+    inline dxl_timing get_timing(int id, int instruction) 
+    { 
+        return gTimeout.get(id, instruction); 
+    }
+    
+    /// Clears the response time statistics, the fixed timeouts are used
+    /// until new times are measured
+    inline void reset_timing() { gTimeout.reset(); }
+    
+    /// Returns the safety margin of the measured timeouts
+    inline double get_timeout_margin() { return gTimeout.get_margin(); }
+    
+    /// Sets the safety margin that multiplies the measured response times
+    /// @param margin Margin, at least 1
+    inline void set_timeout_margin(double margin) 
+    { 
+        gTimeout.set_margin(margin); 
+    }
+    
+    /// Selects the timeouts from the measured response times or the fixed 
+    /// ones computed from the packet length and the port latency
+    inline void set_adaptive_timeout(bool adaptive) 
+    { 
+        gTimeout.set_enabled(adaptive); 
+    }
+    
+    /// Returns the statistics of the received byte stream
+    inline dxl_parser_stats get_parser_stats() { return gParser.stats(); }
+    
     /// Ping to the selected id, check com status for the ping result
     /// @param id ID where the ping is done
     void ping(int id);
     
+    /// Pings the selected ID and reads its model number and firmware 
+    /// version. Protocol 2.0 sends them in the ping status packet, with 
+    /// Protocol 1.0 they're read from the start of the control table
+    /// @param id ID where the ping is done
+    /// @param model Model number, -1 if it couldn't be read
+    /// @param firmware Firmware version, -1 if it couldn't be read
+    /// @return True if the servo answered the ping
+    bool identify(int id, int &model, int &firmware);
+    
     /// Reads a byte from the selected ID at the selected address
     /// @param id Selects the ID to read the byte
     /// @param address Selects the address to read the byte
@@ -179,7 +429,51 @@ public:
     /// @param value Value to set at the selected location
     void write_word(int id, int address, int value);    
     
-    /// Returns the packet time
+    /// Reads a word from all the selected IDs, same as sync_read()
+    /// @param ID Contains the IDs to read the word
+    /// @param address Selects the address to read the word
+    /// @param value Stores the read words, -1 if it couldn't be read
+    /// @param time Stores the time in ms when every word was received
+    /// @return Number of words correctly read
+    int bulk_read_word(const QVector<int> &ID, int address, 
+                       QVector<int> &value, QVector<double> &time);
+    
+    /// Reads the same register from all the selected IDs in a single bus
+    /// transaction. Protocol 2.0 uses FAST_SYNC_READ (one status packet for
+    /// all the servos) or SYNC_READ and protocol 1.0 uses BULK_READ. When
+    /// nobody answers the servos are read one by one, and after a few group
+    /// reads in a row that they answer that way the next slower group read
+    /// is used. The fastest one is tested again now and then
+    /// @param ID Contains the IDs to read
+    /// @param address Selects the register address
+    /// @param length Register length, up to 4 bytes
+    /// @param value Stores the read values, -1 if it couldn't be read
+    /// @param time Stores the time in ms when every value was received
+    /// @return Number of values correctly read
+    int sync_read(const QVector<int> &ID, int address, int length,
+                  QVector<int> &value, QVector<double> &time);
+    
+    /// Registers a write in the servo, it's executed when the servo receives
+    /// an ACTION instruction. A servo only keeps the last registered write
+    /// @param id Selects the ID to write
+    /// @param address First address to write
+    /// @param data Contains the bytes to write
+    void reg_write(int id, int address, const QVector<int> &data);
+    
+    /// Executes the registered writes
+    /// @param id Selects the ID, by default all the servos
+    void action(int id = BROADCAST_ID);
+    
+    /// Writes the same registers of several servos with a single SYNC_WRITE
+    /// instruction, the servos don't send any status packet
+    /// @param ID Contains the IDs to write
+    /// @param address First address to write
+    /// @param length Number of bytes written to every servo
+    /// @param data Contains length bytes for every servo in the ID order
+    void sync_write(const QVector<int> &ID, int address, int length, 
+                    const QVector<int> &data);
+    
+    /// Returns the elapsed time in ms since the packet was sent
     double get_packet_time();
     
     /// Sets the timeout in number of received bytes
@@ -0,0 +1,360 @@
+/// @file kinematics.cpp Contains the Kinematics class implementation
+#include "kinematics.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#undef M_PI
+#define M_PI 3.14159265358979323846264338327
+
+namespace {
+
+/// Scalar operations used by the batched inverse kinematics kernel
+struct Scalar
+{
+    typedef double V;
+    static const int N = 1;
+    
+    static inline V load(const double *p) { return *p; }
+    static inline void store(double *p, V a) { *p = a; }
+    static inline V set(double a) { return a; }
+    static inline V add(V a, V b) { return a + b; }
+    static inline V sub(V a, V b) { return a - b; }
+    static inline V mul(V a, V b) { return a * b; }
+    static inline V div(V a, V b) { return a / b; }
+    static inline V sqrt(V a) { return std::sqrt(a); }
+    static inline V abs(V a) { return std::fabs(a); }
+    static inline V nan() { return std::nan(""); }
+    static inline V lt(V a, V b) { return a < b ? 1 : 0; }
+    static inline V le(V a, V b) { return a <= b ? 1 : 0; }
+    static inline V unord(V a, V b) { return std::isnan(a + b) ? 1 : 0; }
+    static inline V and_(V m, V n) { return m != 0 and n != 0 ? 1 : 0; }
+    static inline V or_(V m, V n) { return m != 0 or n != 0 ? 1 : 0; }
+    static inline V not_(V m) { return m != 0 ? 0 : 1; }
+    static inline V select(V m, V a, V b) { return m != 0 ? a : b; }
+    static inline int mask(V m) { return m != 0 ? 1 : 0; }
+};
+
+#if defined(__AVX2__)
+
+/// AVX2 operations, 4 doubles at once
+struct Simd
+{
+    typedef __m256d V;
+    static const int N = 4;
+    
+    static inline V load(const double *p) { return _mm256_loadu_pd(p); }
+    static inline void store(double *p, V a) { _mm256_storeu_pd(p, a); }
+    static inline V set(double a) { return _mm256_set1_pd(a); }
+    static inline V add(V a, V b) { return _mm256_add_pd(a, b); }
+    static inline V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+    static inline V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+    static inline V div(V a, V b) { return _mm256_div_pd(a, b); }
+    static inline V sqrt(V a) { return _mm256_sqrt_pd(a); }
+    static inline V abs(V a) { return _mm256_andnot_pd(set(-0.0), a); }
+    static inline V nan() { return set(std::nan("")); }
+    static inline V lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+    static inline V le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+    static inline V unord(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_UNORD_Q); }
+    static inline V and_(V m, V n) { return _mm256_and_pd(m, n); }
+    static inline V or_(V m, V n) { return _mm256_or_pd(m, n); }
+    static inline V not_(V m) { return _mm256_xor_pd(m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))); }
+    static inline V select(V m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+    static inline int mask(V m) { return _mm256_movemask_pd(m); }
+};
+#define KINEMATICS_SIMD "AVX2"
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+/// SSE2 operations, 2 doubles at once
+struct Simd
+{
+    typedef __m128d V;
+    static const int N = 2;
+    
+    static inline V load(const double *p) { return _mm_loadu_pd(p); }
+    static inline void store(double *p, V a) { _mm_storeu_pd(p, a); }
+    static inline V set(double a) { return _mm_set1_pd(a); }
+    static inline V add(V a, V b) { return _mm_add_pd(a, b); }
+    static inline V sub(V a, V b) { return _mm_sub_pd(a, b); }
+    static inline V mul(V a, V b) { return _mm_mul_pd(a, b); }
+    static inline V div(V a, V b) { return _mm_div_pd(a, b); }
+    static inline V sqrt(V a) { return _mm_sqrt_pd(a); }
+    static inline V abs(V a) { return _mm_andnot_pd(set(-0.0), a); }
+    static inline V nan() { return set(std::nan("")); }
+    static inline V lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+    static inline V le(V a, V b) { return _mm_cmple_pd(a, b); }
+    static inline V unord(V a, V b) { return _mm_cmpunord_pd(a, b); }
+    static inline V and_(V m, V n) { return _mm_and_pd(m, n); }
+    static inline V or_(V m, V n) { return _mm_or_pd(m, n); }
+    static inline V not_(V m) { return _mm_xor_pd(m, _mm_castsi128_pd(_mm_set1_epi32(-1))); }
+    static inline V select(V m, V a, V b) 
+    { 
+        return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); 
+    }
+    static inline int mask(V m) { return _mm_movemask_pd(m); }
+};
+#define KINEMATICS_SIMD "SSE2"
+
+#else
+
+typedef Scalar Simd;
+#define KINEMATICS_SIMD "None"
+
+#endif
+
+/// Geometry used by the kernel
+struct Geometry
+{
+    double a, b, L1, L2, cos60, sin60, minAngle, maxAngle;
+};
+
+/// Vectorizable atan2 (Cephes atan polynomial with octant reduction)
+template<class T>
+inline typename T::V atan2v(typename T::V y, typename T::V x)
+{
+    typedef typename T::V V;
+    
+    V ax = T::abs(x), ay = T::abs(y);
+    V swap = T::lt(ax, ay);
+    V num = T::select(swap, ax, ay);
+    V den = T::select(swap, ay, ax);
+    V zero = T::set(0.0);
+    V t = T::select(T::le(den, zero), zero, T::div(num, den));
+    
+    // t in [0, 1], reduced to [-0.2, 0.66]
+    V big = T::lt(T::set(0.66), t);
+    V u = T::select(big, T::div(T::sub(t, T::set(1.0)), T::add(t, T::set(1.0))), t);
+    V z = T::mul(u, u);
+    
+    V p = T::set(-8.750608600031904122785E-1);
+    p = T::add(T::mul(p, z), T::set(-1.615753718733365076637E1));
+    p = T::add(T::mul(p, z), T::set(-7.500855792314704667340E1));
+    p = T::add(T::mul(p, z), T::set(-1.228866684490136173410E2));
+    p = T::add(T::mul(p, z), T::set(-6.485021904942025371773E1));
+    V q = T::add(z, T::set(2.485846490142306297962E1));
+    q = T::add(T::mul(q, z), T::set(1.650270098316988542046E2));
+    q = T::add(T::mul(q, z), T::set(4.328810604912902668951E2));
+    q = T::add(T::mul(q, z), T::set(4.853903996359136964868E2));
+    q = T::add(T::mul(q, z), T::set(1.945506571482613964425E2));
+    
+    V r = T::add(u, T::mul(T::mul(u, z), T::div(p, q)));
+    r = T::select(big, T::add(r, T::set(M_PI/4)), r);
+    
+    // Back to the original octant
+    r = T::select(swap, T::sub(T::set(M_PI/2), r), r);
+    r = T::select(T::lt(x, zero), T::sub(T::set(M_PI), r), r);
+    r = T::select(T::lt(y, zero), T::sub(zero, r), r);
+    return T::select(T::unord(x, y), T::nan(), r);
+}
+
+/// Servo angle in degrees of one arm, same as Kinematics::singleAngle()
+template<class T>
+inline typename T::V anglev(const Geometry &g, typename T::V x0, 
+                            typename T::V y0, typename T::V z0)
+{
+    typedef typename T::V V;
+    
+    V zero = T::set(0.0);
+    V a2 = T::set(g.a*g.a);
+    V x02 = T::mul(x0, x0), y02 = T::mul(y0, y0), z02 = T::mul(z0, z0);
+    V xy2 = T::add(x02, y02);
+    
+    V n = T::sub(T::sub(T::sub(T::set(g.b*g.b - g.a*g.a), z02), x02), y02);
+    V n2 = T::mul(n, n);
+    V disc = T::sub(T::mul(n2, y02), 
+                    T::mul(T::mul(T::set(4.0), xy2), 
+                           T::add(T::sub(zero, T::mul(x02, a2)), 
+                                  T::mul(n2, T::set(0.25)))));
+    V raiz = T::sqrt(disc);
+    V neg = T::lt(x0, zero);
+    raiz = T::select(neg, T::sub(zero, raiz), raiz);
+    
+    V y = T::div(T::add(T::sub(zero, T::mul(n, y0)), raiz), 
+                 T::mul(T::set(2.0), xy2));
+    
+    V ya = T::add(y0, T::set(g.a));
+    V flip = T::and_(T::lt(T::sub(T::set(g.b*g.b), T::mul(ya, ya)), 
+                           T::add(x02, z02)), neg);
+    V x = T::sqrt(T::sub(a2, T::mul(y, y)));
+    x = T::select(flip, T::sub(zero, x), x);
+    
+    return T::sub(T::set(150.0), T::mul(atan2v<T>(y, x), T::set(180.0/M_PI)));
+}
+
+/// Batched inverse kinematics of T::N positions
+template<class T>
+inline void inversev(const Geometry &g, const double *px, const double *py, 
+                     const double *pz, double *d0, double *d1, double *d2, 
+                     unsigned char *valid)
+{
+    typedef typename T::V V;
+    
+    V x = T::load(px), y = T::load(py), z = T::load(pz);
+    V c = T::set(g.cos60), s = T::set(g.sin60), off = T::set(g.L2 - g.L1);
+    V zero = T::set(0.0);
+    V y0 = T::sub(zero, z);
+    
+    V D0 = anglev<T>(g, T::add(x, off), y0, y);
+    V D1 = anglev<T>(g, T::add(T::sub(T::mul(y, s), T::mul(x, c)), off), y0,
+                     T::sub(T::sub(zero, T::mul(y, c)), T::mul(x, s)));
+    V D2 = anglev<T>(g, T::add(T::sub(T::sub(zero, T::mul(y, s)), T::mul(x, c)), off), 
+                     y0, T::add(T::sub(zero, T::mul(y, c)), T::mul(x, s)));
+    
+    T::store(d0, D0);
+    T::store(d1, D1);
+    T::store(d2, D2);
+    
+    if (valid == NULL) return;
+    
+    // Comparisons with NaN are false, so unreachable positions are invalid
+    V lo = T::set(g.minAngle), hi = T::set(g.maxAngle);
+    V ok = T::and_(T::le(lo, D0), T::le(D0, hi));
+    ok = T::and_(ok, T::and_(T::le(lo, D1), T::le(D1, hi)));
+    ok = T::and_(ok, T::and_(T::le(lo, D2), T::le(D2, hi)));
+    
+    int m = T::mask(ok);
+    for (int i = 0; i < T::N; ++i) valid[i] = (m >> i) & 1;
+}
+
+}
+
+bool Kinematics::forward(const QVector<double> &D, QVector4D &pos) const
+{
+    double x, y, z;
+    if (not forward(D[0], D[1], D[2], x, y, z)) return false;
+    
+    pos = QVector4D(x, y, z, D.size() > 3 ? D[3] : 0);
+    return true;
+}
+
+bool Kinematics::forward(double d0, double d1, double d2, 
+                         double &x, double &y, double &z) const
+{
+    // Radial direction of every arm, the same bases used in inverse()
+    const double u[3][2] = { {1, 0}, {-cos60, sin60}, {-cos60, -sin60} };
+    const double d[3] = { d0, d1, d2 };
+    
+    // Elbow positions with the clamp offset already removed
+    double P[3][3];
+    for (int i = 0; i < 3; ++i) {
+        double t = (150.0 - d[i])*M_PI/180.0;
+        double r = L1 - L2 + a*cos(t);
+        P[i][0] = r*u[i][0];
+        P[i][1] = r*u[i][1];
+        P[i][2] = -a*sin(t);
+    }
+    
+    // Orthonormal base with P[0] as origin, ex to P[1] and P[2] in the 
+    // ex ey plane
+    double ex[3], ey[3], ez[3], v[3];
+    for (int k = 0; k < 3; ++k) ex[k] = P[1][k] - P[0][k];
+    double dist = sqrt(ex[0]*ex[0] + ex[1]*ex[1] + ex[2]*ex[2]);
+    if (dist == 0) return false;
+    for (int k = 0; k < 3; ++k) ex[k] /= dist;
+    
+    for (int k = 0; k < 3; ++k) v[k] = P[2][k] - P[0][k];
+    double i = ex[0]*v[0] + ex[1]*v[1] + ex[2]*v[2];
+    for (int k = 0; k < 3; ++k) ey[k] = v[k] - i*ex[k];
+    double n = sqrt(ey[0]*ey[0] + ey[1]*ey[1] + ey[2]*ey[2]);
+    if (n == 0) return false;
+    for (int k = 0; k < 3; ++k) ey[k] /= n;
+    double j = ey[0]*v[0] + ey[1]*v[1] + ey[2]*v[2];
+    
+    ez[0] = ex[1]*ey[2] - ex[2]*ey[1];
+    ez[1] = ex[2]*ey[0] - ex[0]*ey[2];
+    ez[2] = ex[0]*ey[1] - ex[1]*ey[0];
+    
+    // All the spheres have the same radius
+    double px = dist/2;
+    double py = (i*i + j*j)/(2*j) - (i/j)*px;
+    double pz2 = b*b - px*px - py*py;
+    if (pz2 < 0) return false;
+    double pz = sqrt(pz2);
+    
+    // The clamp is under the base, the solution with the highest Z
+    if (ez[2] < 0) pz = -pz;
+    
+    x = P[0][0] + px*ex[0] + py*ey[0] + pz*ez[0];
+    y = P[0][1] + px*ex[1] + py*ey[1] + pz*ez[1];
+    z = P[0][2] + px*ex[2] + py*ey[2] + pz*ez[2];
+    return true;
+}
+
+void Kinematics::inverse(const QVector4D &pos, QVector<double> &D) const
+{
+    inverse(pos.x(), pos.y(), pos.z(), D[0], D[1], D[2]);
+    D[3] = pos.w();
+}
+
+void Kinematics::inverse(double x, double y, double z, 
+                         double &d0, double &d1, double &d2) const
+{
+    double x1 = x + L2 - L1;
+    double y1 = -z;
+    double z1 = y;
+    d0 = 150.0 - singleAngle(x1,y1,z1)*180/M_PI;
+    
+    double x2 = y*sin60 - x*cos60 + L2 - L1;
+    double y2 = -z;
+    double z2 = -y*cos60 - x*sin60;
+    d1 = 150.0 - singleAngle(x2,y2,z2)*180/M_PI;
+    
+    double x3 = -y*sin60 - x*cos60 + L2 - L1;
+    double y3 = -z;
+    double z3 = -y*cos60 + x*sin60;
+    d2 = 150.0 - singleAngle(x3,y3,z3)*180/M_PI;
+}
+
+void Kinematics::inverse(int n, const double *x, const double *y, 
+                         const double *z, double *d0, double *d1, double *d2, 
+                         unsigned char *valid) const
+{
+    Geometry g = { a, b, L1, L2, cos60, sin60, minAngle, maxAngle };
+    
+    int i = 0;
+    for (; i + Simd::N <= n; i += Simd::N) {
+        inversev<Simd>(g, x + i, y + i, z + i, d0 + i, d1 + i, d2 + i, 
+                       valid ? valid + i : NULL);
+    }
+    
+    // Remaining positions
+    for (; i < n; ++i) {
+        inversev<Scalar>(g, x + i, y + i, z + i, d0 + i, d1 + i, d2 + i, 
+                         valid ? valid + i : NULL);
+    }
+}
+
+const char* Kinematics::simd()
+{
+    return KINEMATICS_SIMD;
+}
+
+bool Kinematics::isReachable(double x, double y, double z) const
+{
+    double D[3];
+    inverse(x, y, z, D[0], D[1], D[2]);
+    
+    for (int i = 0; i < 3; ++i) {
+        if (std::isnan(D[i])) return false;
+        if (D[i] > maxAngle or D[i] < minAngle) return false;
+    }
+    return true;
+}
+
+double Kinematics::singleAngle(double x0, double y0, double z0) const
+{
+    double n = b*b - a*a - z0*z0 - x0*x0 - y0*y0;
+    double raiz = sqrt (n*n*y0*y0 - 4*(x0*x0 + y0*y0)*(-x0*x0*a*a + n*n/4));
+    
+    if (x0 < 0) raiz *= -1;
+    double y = (-n*y0 + raiz ) / (2*(x0*x0 + y0*y0));
+    
+    int signe = 1;
+    if ((b*b - (y0 + a)*(y0 + a)) < (x0*x0 + z0*z0) && x0 < 0) signe *= -1;
+    double x = sqrt(a*a - y*y)*signe;
+    return atan2 (y,x);
+}
@@ -0,0 +1,76 @@
+/// @file kinematics.h Contains the Kinematics class declaration
+#ifndef KINEMATICS_H
+#define KINEMATICS_H
+
+#include <QVector>
+#include <QVector4D>
+
+#include <cmath>
+
+/// The Kinematics' class contains the delta robot geometry and solves its
+/// inverse and forward kinematics. The positions are in cm with the Z axis
+/// pointing down from the base and the angles are the servos angles in 
+/// degrees, the fourth value is the clamp rotation.
+class Kinematics
+{
+public:
+    
+    const double cos60 = 0.5;       ///< Contains the cosinus of 60
+    const double sin60 = sqrt(3)/2; ///< Contains the sinus of 60
+    const double a = 11.6;          ///< The arm length
+    const double b = 22.648;        ///< The forearm length
+    const double L1 = 5.499;        ///< The base center length
+    const double L2 = 6.000;        ///< The clamp support center lenght
+    const double minAngle = 126.0;  ///< Minimum servo angle
+    const double maxAngle = 240.0;  ///< Maximum servo angle
+    
+    /// Calculates the position of the clamp from the servos angles, the 
+    /// elbows are the centers of three spheres with the forearm length as
+    /// radius and the clamp is at their lower intersection
+    /// @param D Contains the servos angles, at least 3
+    /// @param pos Stores the position, the rotation is D[3] if available
+    /// @return False if the angles don't give a valid position
+    bool forward(const QVector<double> &D, QVector4D &pos) const;
+    
+    /// Overloaded function working with doubles
+    bool forward(double d0, double d1, double d2, 
+                 double &x, double &y, double &z) const;
+    
+    /// Calculates the servos angles of the selected position, the angles
+    /// are NaN if the position can't be reached
+    /// @param pos Selected position
+    /// @param D Stores the angles, it must have 4 values
+    void inverse(const QVector4D &pos, QVector<double> &D) const;
+    
+    /// Overloaded function working with doubles
+    void inverse(double x, double y, double z, 
+                 double &d0, double &d1, double &d2) const;
+    
+    /// Calculates the servos angles of n positions at once, the positions
+    /// and the angles are stored as structure of arrays. It uses AVX2 or SSE2
+    /// vector code when the compiler has it enabled and scalar code if not.
+    /// @param n Number of positions
+    /// @param x Contains the X values
+    /// @param y Contains the Y values
+    /// @param z Contains the Z values
+    /// @param d0 Stores the first servo angles, NaN if unreachable
+    /// @param d1 Stores the second servo angles, NaN if unreachable
+    /// @param d2 Stores the third servo angles, NaN if unreachable
+    /// @param valid If not NULL stores 1 if the position is reachable and 
+    /// the angles are inside the limits and 0 if not
+    void inverse(int n, const double *x, const double *y, const double *z, 
+                 double *d0, double *d1, double *d2, 
+                 unsigned char *valid = NULL) const;
+    
+    /// Returns the name of the vector instruction set used by the batched 
+    /// inverse kinematics
+    static const char* simd();
+    
+    /// Returns true if all the servos angles are inside the limits
+    bool isReachable(double x, double y, double z) const;
+    
+    /// Calculates the angle in radians of one arm in its own base
+    double singleAngle(double x0, double y0, double z0) const;
+};
+
+#endif // KINEMATICS_H
@@ -0,0 +1,110 @@
+/// @file loopscheduler.cpp Contains the LoopScheduler class implementation
+#include "loopscheduler.h"
+
+#include <QThread>
+
+#include "dxl/dxl_clock.h"
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <time.h>
+#endif
+
+LoopScheduler::LoopScheduler(int rate, double ioBudget) :
+    _begin(0),
+    _deadline(0),
+    _ioBudget(0.7),
+    _ioBegin(0),
+    _restart(true)
+{
+    setRate(rate);
+    setIOBudget(ioBudget);
+}
+
+void LoopScheduler::begin()
+{
+    qint64 now = dxl_clock::ns();
+    
+    if (_restart) {
+        _deadline = now;
+        _restart = false;
+    }
+    else _stats.cycle = now - _begin;
+    
+    _begin = now;
+    _stats.io = 0;
+    _deadline += _stats.period;
+}
+
+void LoopScheduler::beginIO()
+{
+    _ioBegin = dxl_clock::ns();
+}
+
+void LoopScheduler::endIO()
+{
+    _stats.io += dxl_clock::ns() - _ioBegin;
+}
+
+void LoopScheduler::resetStats()
+{
+    Stats s;
+    s.rate = _stats.rate;
+    s.period = _stats.period;
+    _stats = s;
+}
+
+void LoopScheduler::setIOBudget(double ioBudget)
+{
+    if (ioBudget < 0.0) ioBudget = 0.0;
+    if (ioBudget > 1.0) ioBudget = 1.0;
+    _ioBudget = ioBudget;
+}
+
+void LoopScheduler::setRate(int rate)
+{
+    if (rate < 0) rate = 0;
+    _stats.rate = rate;
+    _stats.period = rate > 0 ? 1000000000LL/rate : 0;
+    _restart = true;
+}
+
+void LoopScheduler::wait()
+{
+    qint64 now = dxl_clock::ns();
+    
+    _stats.compute = now - _begin - _stats.io;
+    if (_stats.io > _stats.maxIO) _stats.maxIO = _stats.io;
+    if (_stats.compute > _stats.maxCompute) _stats.maxCompute = _stats.compute;
+    ++_stats.cycles;
+    
+    if (isFree()) return;
+    
+    qint64 ioBudget = qint64(_stats.period*_ioBudget);
+    if (_stats.io > ioBudget) ++_stats.ioOverruns;
+    if (_stats.compute > _stats.period - ioBudget) ++_stats.computeOverruns;
+    
+    // Deadline missed, the next cycle starts now instead of trying to 
+    // catch up with the lost cycles
+    if (now >= _deadline) {
+        ++_stats.overruns;
+        _deadline = now;
+        return;
+    }
+    
+    sleepUntil(_deadline);
+}
+
+void LoopScheduler::sleepUntil(qint64 ns)
+{
+#ifdef Q_OS_LINUX
+    // std::chrono::steady_clock uses CLOCK_MONOTONIC
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+#else
+    qint64 left = ns - dxl_clock::ns();
+    if (left > 0) QThread::usleep((unsigned long)(left / 1000));
+#endif
+}
@@ -0,0 +1,112 @@
+/// @file loopscheduler.h Contains the LoopScheduler class declaration
+#ifndef LOOPSCHEDULER_H
+#define LOOPSCHEDULER_H
+
+#include <QtGlobal>
+
+/// The LoopScheduler's class runs a control loop at a fixed rate. Every cycle
+/// sleeps until an absolute deadline so the period doesn't depend on the 
+/// time spent in the bus or the computations. The cycle time is split in 
+/// bus I/O and computation, each one with its own time budget.
+class LoopScheduler
+{
+public:
+    
+    /// Contains the loop timing statistics
+    struct Stats
+    {
+        int rate;               ///< Loop rate in Hz, 0 if free running
+        qint64 period;          ///< Cycle period in ns
+        qint64 cycle;           ///< Last cycle duration in ns
+        qint64 io;              ///< Last bus I/O time in ns
+        qint64 compute;         ///< Last computation time in ns
+        qint64 maxIO;           ///< Maximum bus I/O time in ns
+        qint64 maxCompute;      ///< Maximum computation time in ns
+        quint64 cycles;         ///< Number of cycles done
+        quint64 overruns;       ///< Cycles that missed their deadline
+        quint64 ioOverruns;     ///< Cycles that exceeded the I/O budget
+        quint64 computeOverruns;///< Cycles that exceeded the compute budget
+        
+        /// Default constructor
+        Stats() : rate(0), period(0), cycle(0), io(0), compute(0), maxIO(0),
+            maxCompute(0), cycles(0), overruns(0), ioOverruns(0), 
+            computeOverruns(0) {}
+    };
+    
+    /// Default constructor
+    /// @param rate Loop rate in Hz, 0 for a free running loop
+    /// @param ioBudget Fraction of the period reserved to the bus I/O
+    LoopScheduler(int rate = 0, double ioBudget = 0.7);
+    
+    /// Marks the beginning of a cycle, also restarts the deadlines if the
+    /// loop was stopped
+    void begin();
+    
+    /// Marks the beginning of a bus I/O part of the cycle
+    void beginIO();
+    
+    /// Marks the end of a bus I/O part of the cycle, the time between 
+    /// beginIO() and endIO() is added to the cycle I/O time
+    void endIO();
+    
+    /// Returns the timing statistics
+    inline Stats getStats() const { return _stats; }
+    
+    /// Returns the current rate in Hz
+    inline int getRate() const { return _stats.rate; }
+    
+    /// Returns the time in ns when the I/O budget of the current cycle ends,
+    /// the start of the cycle if the loop is free running
+    inline qint64 ioDeadline() const
+    {
+        return _begin + qint64(_stats.period*_ioBudget);
+    }
+    
+    /// Returns true if the loop is free running
+    inline bool isFree() const { return _stats.rate <= 0; }
+    
+    /// Clears the statistics
+    void resetStats();
+    
+    /// Restarts the deadlines on the next cycle, must be used after the 
+    /// loop has been stopped
+    inline void restart() { _restart = true; }
+    
+    /// Sets the fraction of the period reserved to the bus I/O, the rest 
+    /// is the computation budget
+    /// @param ioBudget Value from 0 to 1
+    void setIOBudget(double ioBudget);
+    
+    /// Sets the loop rate, the deadlines start again on the next cycle
+    /// @param rate Loop rate in Hz, 0 for a free running loop
+    void setRate(int rate);
+    
+    /// Marks the end of the cycle and sleeps until its deadline, if the 
+    /// deadline was missed the following deadlines are moved
+    void wait();
+    
+private:
+    
+    /// Start time of the current cycle in ns
+    qint64 _begin;
+    
+    /// Deadline of the current cycle in ns
+    qint64 _deadline;
+    
+    /// Fraction of the period reserved to the bus I/O
+    double _ioBudget;
+    
+    /// Start time of the current I/O part in ns
+    qint64 _ioBegin;
+    
+    /// True if the deadlines must be restarted
+    bool _restart;
+    
+    /// Contains the statistics
+    Stats _stats;
+    
+    /// Sleeps until the absolute time in ns
+    static void sleepUntil(qint64 ns);
+};
+
+#endif // LOOPSCHEDULER_H
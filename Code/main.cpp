@@ -1,6 +1,9 @@
 /// @file main.cpp Contains the Main of the program 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
 #include "mainwindow.h"
+#include "dxl/dxl_capture.h"
 
 /// @mainpage
 /// This project is a Delta robot controller using Dynamixel AX12 servos.
@@ -8,7 +11,23 @@
 int main(int argc, char *argv[])
 {
 	QApplication a(argc, argv);
+    
+    // The servo bus traffic can be recorded and played back later with the
+    // "replay:" port
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption capture("capture", "Records the servo bus traffic to "
+                               "a capture file.", "file");
+    parser.addOption(capture);
+    parser.process(a);
+    if (parser.isSet(capture) and
+        not dxl_capture::start(parser.value(capture)))
+        qWarning() << "Cannot write" << parser.value(capture);
+    
     MainWindow w;
     w.show();
-    return a.exec();
+    int ret = a.exec();
+    
+    dxl_capture::stop();
+    return ret;
 }
@@ -17,6 +17,11 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(&_sT, SIGNAL(statusBar(QString, int)), 
             ui->statusbar, SLOT(showMessage(QString,int)));
     connect(&_sT, SIGNAL(modeChanged(Mode)), this, SLOT(modeChanged(Mode)));
+    connect(&_sF, SIGNAL(found(QString,int,int,int,int)),
+            this, SLOT(servoFound(QString,int,int,int,int)));
+    connect(&_sF, SIGNAL(unconfirmed(QString)),
+            this, SLOT(servoUnconfirmed(QString)));
+    connect(&_sF, SIGNAL(finished()), this, SLOT(findFinished()));
     
     
     _timer.setInterval(10);
@@ -55,6 +60,7 @@ MainWindow::MainWindow(QWidget *parent) :
     if (!dir.exists()) dir.mkpath(_dataP);
     
     read();
+    checkServos();
     _sT.start();
 }
 
@@ -99,12 +105,58 @@ void MainWindow::read(QString path)
 {
     QDir dir(path); 
     _sT.read(dir.filePath("servo.opts"));
+    _sT.loadWorkspace(dir.filePath("workspace.grid"));
+    _inv.load(dir.filePath("servos.inv"));
 }
 
 void MainWindow::write(QString path)
 {
     QDir dir(path);    
     _sT.write(dir.filePath("servo.opts"));
+    _inv.save(dir.filePath("servos.inv"));
+}
+
+void MainWindow::checkServos()
+{
+    QString portS, portC;
+    int baudS, baudC;
+    _sT.getServoPortInfo(portS, baudS);
+    _sT.getClampPortInfo(portC, baudC);
+    int protocol = _sT.getServoProtocol();
+    
+    QStringList ports;
+    if (not portS.isEmpty()) ports << portS;
+    if (not portC.isEmpty() and portC != portS) ports << portC;
+    
+    if (ports.isEmpty()) return;
+    
+    // The serial ports aren't used from the GUI thread, the scan thread
+    // pings the servos of every port and scans the ones with other servos
+    QVector<int> bauds;
+    bauds << baudS << baudC << ServoFind::standardBauds();
+    _sF.setData(ports, bauds, 0, MAX_ID, protocol);
+    _sF.setInventory(_inv);
+    _sF.start();
+    ui->statusbar->showMessage("Checking the servos");
+}
+
+void MainWindow::findFinished()
+{
+    QDir dir(_dataP);
+    _inv.save(dir.filePath("servos.inv"));
+    ui->statusbar->showMessage("Servos checked", 2000);
+}
+
+void MainWindow::servoFound(QString port, int baud, int id, int model,
+                            int firmware)
+{
+    if (model >= 0) _inv.add(port, baud, id, model, firmware);
+}
+
+void MainWindow::servoUnconfirmed(QString port)
+{
+    _inv.remove(port);
+    ui->statusbar->showMessage("Scanning the servos");
 }
 
 void MainWindow::joyChanged()
@@ -152,7 +204,7 @@ void MainWindow::on_actionOptions_triggered()
     _sT.pause();
     ui->start->setText("Start");
     
-    OptionsWindow o(_joy, &_sT, this);
+    OptionsWindow o(_joy, &_sT, &_inv, this);
     
     connect(this, SIGNAL(joystickChanged()), &o, SLOT(joystickChanged()));
     
@@ -226,8 +278,9 @@ void MainWindow::update()
     }
     _sT.setData(_axisV, _butsV);
     
-    QVector<ServoThread::Servo> servo = _sT.getServosInfo();
-    QVector4D pos = _sT.getCurrentPos();
+    // Last servo loop snapshot, lock free
+    const ServoThread::Telemetry &tel = _sT.getTelemetry();
+    const QVector4D &pos = tel.pos;
     QString x = QString::number(pos.x());
     QString y = QString::number(pos.y());
     QString z = QString::number(pos.z());
@@ -235,14 +288,24 @@ void MainWindow::update()
     ui->pos->setText(x + " " + y + " " + z + " " + rot + "º");
     
     // Updating position sliders
-    ui->servo0S->setValue(servo[0].pos);
-    ui->servo1S->setValue(servo[1].pos);
-    ui->servo2S->setValue(servo[2].pos);
-    ui->servo3S->setValue(servo[3].pos);
+    ui->servo0S->setValue(tel.servo[0]);
+    ui->servo1S->setValue(tel.servo[1]);
+    ui->servo2S->setValue(tel.servo[2]);
+    ui->servo3S->setValue(tel.servo[3]);
     
     // Updating position labels
-    ui->servo0->setText(QString::number(servo[0].pos));
-    ui->servo1->setText(QString::number(servo[1].pos));
-    ui->servo2->setText(QString::number(servo[2].pos)); 
-    ui->servo3->setText(QString::number(servo[3].pos));
+    ui->servo0->setText(QString::number(tel.servo[0]));
+    ui->servo1->setText(QString::number(tel.servo[1]));
+    ui->servo2->setText(QString::number(tel.servo[2])); 
+    ui->servo3->setText(QString::number(tel.servo[3]));
+    
+    // Read errors of every servo
+    QLabel *labels[] = { ui->servo0, ui->servo1, ui->servo2, ui->servo3 };
+    for (int i = 0; i < 4; ++i) {
+        const ServoHealth::Stats &h = tel.health[i];
+        labels[i]->setToolTip(QString("Failed reads %1 of %2, %3 retries "
+                                      "(%4 good), up to %5 in a row")
+                              .arg(h.failures).arg(h.cycles).arg(h.retries)
+                              .arg(h.recovered).arg(h.maxFailed));
+    }
 }
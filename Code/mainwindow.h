@@ -9,6 +9,8 @@
 #include "dxl/ax12.h"
 #include "dxl/dynamixel.h"
 #include "optionswindow.h"
+#include "servofind.h"
+#include "servoinventory.h"
 #include "servothread.h"
 
 /// Namespace to work with a User Interface Qt Form
@@ -71,6 +73,13 @@ private:
     /// Contains the thread controlling all the servos and external hardware
     ServoThread _sT;
     
+    /// Contains the servos found in every adapter
+    ServoInventory _inv;
+    
+    /// Confirms the servos of the inventory, the ports whose servos have
+    /// changed are scanned
+    ServoFind _sF;
+    
     /// To update the joystick value
     QTimer _timer;
     
@@ -94,10 +103,23 @@ private:
     
     /// Writes the data to disk overloaded function
     void write(QString path);
+    
+    /// Starts the confirmation of the servos of the inventory out of the
+    /// GUI thread, the ports with other servos are scanned again
+    void checkServos();
 
         
 private slots:
     
+    /// Handles the end of the servos scan
+    void findFinished();
+    
+    /// Adds a servo found by the scan to the inventory
+    void servoFound(QString port, int baud, int id, int model, int firmware);
+    
+    /// Forgets the servos of a port that is scanned again
+    void servoUnconfirmed(QString port);
+    
     /// Handles a joystick update
     void joyChanged();
     
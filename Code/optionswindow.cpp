@@ -2,11 +2,14 @@
 #include "optionswindow.h"
 #include "ui_optionswindow.h"
 
-OptionsWindow::OptionsWindow(XJoystick &J, ServoThread *servo, QWidget *parent) :
+OptionsWindow::OptionsWindow(XJoystick &J, ServoThread *servo,
+                             ServoInventory *inventory, QWidget *parent) :
     QDialog(parent),
     _joy(J),
     _portSize(-1),
     _servo(servo),
+    _inv(inventory),
+    _found(0),
     _timer(this),
     ui(new Ui::OptionsWindow)
 {
@@ -20,6 +23,9 @@ OptionsWindow::OptionsWindow(XJoystick &J, ServoThread *servo, QWidget *parent)
     
     connect(&_sF, SIGNAL(finished()), this, SLOT(refreshFinish()));
     
+    connect(&_sF, SIGNAL(found(QString,int,int,int,int)),
+            this, SLOT(servoFound(QString,int,int,int,int)));
+    
     connect(&_timer, SIGNAL(timeout()), this, SLOT(events()));
     
     
@@ -61,15 +67,30 @@ OptionsWindow::OptionsWindow(XJoystick &J, ServoThread *servo, QWidget *parent)
     QString port;
     int baud;
     _servo->getServoPortInfo(port, baud);
+    
+    // The servos of the inventory can be selected without a refresh
+    for (const ServoInventory::Servo &s : _inv->servos(port)) {
+        if (s.baud != baud) continue;
+        for (QComboBox *c : _servoC) {
+            if (c->findData(s.ID) < 0) c->addItem(QString::number(s.ID), s.ID);
+        }
+    }
+    
     ui->speed->setValue(_servo->getSpeed());
+    ui->rate->setValue(_servo->getRate());
     ui->baudRS->setValue(baud);
     ui->portS->addItem("", port);
+    
+    _servo->getClampPortInfo(port, baud);
+    ui->baudRC->setValue(baud);
+    ui->portC->addItem("", port);
 }
 
 OptionsWindow::~OptionsWindow()
 {
+    _sF.stop();
+    _sF.wait();
     delete ui;
-    if (_sF.isRunning()) _sF.exit();
 }
 
 void OptionsWindow::storeData()
@@ -83,11 +104,16 @@ void OptionsWindow::storeData()
     int baudS(ui->baudRS->value());
     _servo->setServoPortInfo(portS, baudS);
     
+    QString portC(ui->portC->currentData().toString());
+    int baudC(ui->baudRC->value());
+    _servo->setClampPortInfo(portC, baudC);
+    
     QVector<int> sID;
     for (QComboBox *s : _servoC) sID.push_back(s->currentData().toInt());
     
     _servo->setSID(sID);
     _servo->setSpeed(ui->speed->value());
+    _servo->setRate(ui->rate->value());
 }
 
 void OptionsWindow::joystickChanged()
@@ -129,16 +155,22 @@ void OptionsWindow::events()
         ui->portC->addItem("None", "");
         ui->portS->addItem("None", "");
         
+        // Simulated servos, to try the robot without the hardware
+        ui->portC->addItem("Simulator", "sim:");
+        ui->portS->addItem("Simulator", "sim:");
+        if (portC == "sim:") selC = 1;
+        if (portS == "sim:") selS = 1;
+        
         for (int i = 0; i < ports.size(); ++i) {
             QString text(ports[i].portName());
             text += ": " + ports[i].description();
             ui->portC->addItem(text, ports[i].portName());
             ui->portS->addItem(text, ports[i].portName()); 
-            if (ports[i].portName() == portC) selC = i + 1;
-            if (ports[i].portName() == portS) selS = i + 1;
+            if (ports[i].portName() == portC) selC = i + 2;
+            if (ports[i].portName() == portS) selS = i + 2;
         }
         
-        if (selS == 0 && ports.size() > 0) selS = 1;
+        if (selS == 0 && ports.size() > 0) selS = 2;
 
         ui->portC->setCurrentIndex(selC);
         ui->portS->setCurrentIndex(selS);
@@ -161,18 +193,70 @@ void OptionsWindow::buttonClicked(QAbstractButton *but)
 void OptionsWindow::on_servoRefresh_clicked()
 {
     if (_sF.isRunning()) return;
-    QString port;
-    int baud;
-    _servo->getServoPortInfo(port, baud);
+    
+    // The lists are filled while the servos are found, the selected ones
+    // are selected again
+    _sel.clear();
+    for (QComboBox *s : _servoC) {
+        _sel.push_back(s->currentData().toInt());
+        s->clear();
+        s->addItem("None", -1);
+    }
+    _found = 0;
+    
+    // Both ports at once, the selected baud rates first and then the other
+    // ones to find the servos with a wrong baud rate
+    QString portS, portC;
+    int baudS, baudC;
+    _servo->getServoPortInfo(portS, baudS);
+    _servo->getClampPortInfo(portC, baudC);
+    
+    QVector<int> bauds;
+    bauds << baudS << baudC << ServoFind::standardBauds();
+    
+    // The scan replaces the servos of the inventory
+    _inv->remove(portS);
+    if (not portC.isEmpty()) _inv->remove(portC);
+    
     int min = ui->min->value();
     int max = ui->max->value();
-    _sF.setData(_servoC, port, baud, min, max);
+    _sF.setData(QStringList() << portS << portC, bauds, min, max, 
+                _servo->getServoProtocol());
     _sF.start();
 }
 
 void OptionsWindow::refreshFinish()
 {
     ui->progressBar->setValue(0);
+    status->showMessage(QString::number(_found) + " servos found", 2000);
+}
+
+void OptionsWindow::servoFound(QString port, int baud, int id, int model,
+                               int firmware)
+{
+    ++_found;
+    if (model >= 0) _inv->add(port, baud, id, model, firmware);
+    
+    // The servos that can't be used with the current settings show where
+    // they were found
+    QString portS, portC;
+    int baudS, baudC;
+    _servo->getServoPortInfo(portS, baudS);
+    _servo->getClampPortInfo(portC, baudC);
+    bool usable = (port == portS and baud == baudS) or 
+                  (port == portC and baud == baudC);
+    
+    QString text(QString::number(id));
+    if (not usable) {
+        text += " (" + port + ", " + QString::number(baud) + " bps)";
+        status->showMessage("Servo " + text, 5000);
+    }
+    
+    for (int i = 0; i < _servoC.size(); ++i) {
+        _servoC[i]->addItem(text, id);
+        if (usable and _sel[i] == id) 
+            _servoC[i]->setCurrentIndex(_servoC[i]->count() - 1);
+    }
 }
 
 void OptionsWindow::keyPressEvent(QKeyEvent *event)
@@ -7,6 +7,7 @@
 // User libraries
 #include "servothread.h"
 #include "servofind.h"
+#include "servoinventory.h"
 
 namespace Ui {
 class OptionsWindow;
@@ -24,10 +25,13 @@ public:
     /// Default constructor must be intialized with a few values
     /// @param J Refernce to the Joystick handler
     /// @param servo Pointer to the ServoThread
+    /// @param inventory Pointer to the servo inventory, updated by the
+    /// servos refresh
     /// @param aX Axis for the X value
     /// @param aY Axis for the Y value
     /// @param aZ Axis for the Z value
-    explicit OptionsWindow(XJoystick &J, ServoThread *servo, QWidget *parent = 0);
+    explicit OptionsWindow(XJoystick &J, ServoThread *servo,
+                           ServoInventory *inventory, QWidget *parent = 0);
     
     /// Destructor
     ~OptionsWindow();
@@ -39,7 +43,7 @@ public slots:
     
     /// To handle the change of a joystick
     void joystickChanged();
-
+    
 private slots:
     
     /// Handles events that need to be updated continously
@@ -54,6 +58,15 @@ private slots:
     /// Handles the endig of refresh function
     void refreshFinish();
     
+    /// Adds a servo found by the refresh to the servo lists and to the
+    /// inventory
+    /// @param port Port name
+    /// @param baud Baud rate
+    /// @param id Servo ID
+    /// @param model Model number, -1 if it couldn't be read
+    /// @param firmware Firmware version, -1 if it couldn't be read
+    void servoFound(QString port, int baud, int id, int model, int firmware);
+    
 private:
     
     /// Contains the Joystick to handle options
@@ -65,12 +78,21 @@ private:
     /// Pointer to the servo thread class
     ServoThread *_servo;
     
+    /// Pointer to the servo inventory
+    ServoInventory *_inv;
+    
     /// Contains all servo QComboBoxes
     QVector< QComboBox *> _servoC;
     
     /// Thread to find the servos in a non blocking operation
     ServoFind _sF;
     
+    /// Servo IDs selected when the refresh started
+    QVector<int> _sel;
+    
+    /// Number of servos found by the refresh
+    int _found;
+    
     /// Status bar
     QStatusBar *status;
     
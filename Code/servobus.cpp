@@ -0,0 +1,224 @@
+/// @file servobus.cpp Contains the ServoBus class implementation
+#include "servobus.h"
+#include "dxl/dxl_clock.h"
+
+ServoBus::ServoBus(const QVector<int> &servos) :
+    _bus(NULL),
+    _index(servos),
+    _A(servos.size()),
+    _pos(servos.size(), -1),
+    _time(servos.size(), 0.0),
+    _retries(servos.size(), 0),
+    _retryUntil(0),
+    _goal(servos.size(), qQNaN()),
+    _ratio(servos.size(), -1),
+    _speed(100.0),
+    _job(None),
+    _stop(false)
+{
+    
+}
+
+ServoBus::~ServoBus()
+{
+    stopIO();
+    detach();
+}
+
+void ServoBus::attach(const QString &port, int baud, int protocol)
+{
+    detach();
+    _port = port;
+    _bus = dxl_bus::attach(port, baud, protocol);
+    
+    // Another client could have opened the port with other settings. The
+    // servos could have been powering up when the group read was degraded
+    dxl_bus_locker dxl(_bus, dxl_bus::Control);
+    dxl->set_protocol(protocol);
+    if (dxl->get_baudrate() != baud) dxl->change_baudrate(baud);
+    dxl->reset_group_read();
+    
+    // The servos could have been written while the bus was released
+    for (AX12 &a : _A) {
+        a.setDxl(dxl.get());
+        a.invalidate();
+    }
+}
+
+void ServoBus::detach()
+{
+    if (_bus == NULL) return;
+    
+    for (AX12 &a : _A) a.setDxl(NULL);
+    dxl_bus::detach(_bus);
+    _bus = NULL;
+    _port.clear();
+}
+
+bool ServoBus::isOpen()
+{
+    if (_bus == NULL) return false;
+    
+    dxl_bus_locker dxl(_bus, dxl_bus::Config);
+    return dxl->isOpen();
+}
+
+dxl_fault_stats ServoBus::faults()
+{
+    if (_bus == NULL) return dxl_fault_stats();
+    
+    dxl_bus_locker dxl(_bus, dxl_bus::Config);
+    return dxl->get_faults();
+}
+
+void ServoBus::setup(const QVector<int> &ID, double speed, uchar ccw, uchar cw)
+{
+    if (_bus == NULL) return;
+    
+    QVector<int> id(_index.size());
+    for (int i = 0; i < _index.size(); ++i) id[i] = ID[_index[i]];
+    
+    dxl_bus_locker dxl(_bus, dxl_bus::Control);
+    AX12::setID(_A, id);
+    AX12::setSpeed(_A, speed);
+    AX12::setComplianceSlope(_A, ccw, cw);
+}
+
+void ServoBus::read(qint64 retryUntil)
+{
+    _retryUntil = retryUntil;
+    post(Read);
+}
+
+void ServoBus::moveTo(const QVector<double> &goal, const QVector<double> &ratio,
+                      double speed)
+{
+    for (int i = 0; i < _index.size(); ++i) {
+        _goal[i] = goal[_index[i]];
+        _ratio[i] = ratio[_index[i]];
+    }
+    _speed = speed;
+    post(Move);
+}
+
+QVector<double> ServoBus::speedRatios(const QVector<double> &from, 
+                                      const QVector<double> &to, int joints)
+{
+    int n = qMin(from.size(), to.size());
+    QVector<double> ratio(to.size(), -1);
+    double longest = 0;
+    for (int i = 0; i < n and i < joints; ++i) {
+        if (from[i] < 0 or qIsNaN(from[i]) or qIsNaN(to[i])) continue;
+        longest = qMax(longest, qAbs(to[i] - from[i]));
+    }
+    if (longest <= 0) return ratio;
+    
+    for (int i = 0; i < n and i < joints; ++i) {
+        if (from[i] < 0 or qIsNaN(from[i]) or qIsNaN(to[i])) continue;
+        ratio[i] = qAbs(to[i] - from[i])/longest;
+    }
+    return ratio;
+}
+
+void ServoBus::finish()
+{
+    QMutexLocker m(&_mutex);
+    while (_job != None) _doneCond.wait(&_mutex);
+}
+
+void ServoBus::getPositions(QVector<double> &pos, QVector<double> &time) const
+{
+    for (int i = 0; i < _index.size(); ++i) {
+        pos[_index[i]] = _pos[i];
+        time[_index[i]] = _time[i];
+    }
+}
+
+void ServoBus::getRetries(QVector<int> &retries) const
+{
+    for (int i = 0; i < _index.size(); ++i) retries[_index[i]] = _retries[i];
+}
+
+void ServoBus::startIO()
+{
+    if (isRunning()) return;
+    
+    _stop = false;
+    start();
+}
+
+void ServoBus::stopIO()
+{
+    if (not isRunning()) return;
+    
+    _mutex.lock();
+    _stop = true;
+    _jobCond.wakeOne();
+    _mutex.unlock();
+    wait();
+}
+
+void ServoBus::post(Job job)
+{
+    QMutexLocker m(&_mutex);
+    _job = job;
+    
+    if (isRunning()) {
+        _jobCond.wakeOne();
+        return;
+    }
+    
+    m.unlock();
+    process();
+    m.relock();
+    _job = None;
+}
+
+void ServoBus::process()
+{
+    // The servos without a port are read as not answering
+    if (_bus == NULL) {
+        if (_job == Read) {
+            _pos.fill(-1);
+            _retries.fill(0);
+        }
+        return;
+    }
+    
+    dxl_bus_locker dxl(_bus, dxl_bus::Control);
+    if (_job == Read) {
+        _retries.fill(0);
+        if (AX12::getCurrentPos(_A, _pos, _time) == _A.size()) return;
+        
+        // A corrupted status packet loses a single servo, reading it again
+        // is faster than waiting for the next cycle
+        for (int i = 0; i < _A.size(); ++i) {
+            if (_pos[i] >= 0) continue;
+            if (dxl_clock::ns() >= _retryUntil) break;
+            
+            ++_retries[i];
+            _pos[i] = _A[i].getCurrentPos();
+            if (_pos[i] >= 0) _time[i] = dxl->get_rxpacket_time()/1000000.0;
+        }
+    }
+    else if (_job == Move) 
+        AX12::moveTo(_A, _goal, _ratio, _speed);
+}
+
+void ServoBus::run()
+{
+    QMutexLocker m(&_mutex);
+    while (not _stop) {
+        if (_job == None) {
+            _jobCond.wait(&_mutex);
+            continue;
+        }
+        
+        m.unlock();
+        process();
+        m.relock();
+        
+        _job = None;
+        _doneCond.wakeAll();
+    }
+}
@@ -0,0 +1,166 @@
+/// @file servobus.h Contains the ServoBus class declaration
+#ifndef SERVOBUS_H
+#define SERVOBUS_H
+
+#include "dxl/ax12.h"
+#include "dxl/dxl_bus.h"
+
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+/// The ServoBus's class drives the servos connected to one serial port.
+/// With several ports every bus has its own I/O thread, the servo thread
+/// gives them the cycle job and waits until all of them have finished, so
+/// the cycle bus time is the one of the busiest port instead of the sum of
+/// all of them. A single bus does its jobs in the calling thread.
+class ServoBus : public QThread
+{
+public:
+    
+    /// Initialization constructor
+    /// @param servos Indexes of the bus servos in the robot vectors
+    explicit ServoBus(const QVector<int> &servos);
+    
+    /// Default destructor, stops the I/O thread and releases the port
+    ~ServoBus();
+    
+    /// Attaches to a port, the shadow tables of the servos are cleared
+    /// @param port Port name
+    /// @param baud Baud rate
+    /// @param protocol Dynamixel protocol version
+    void attach(const QString &port, int baud, int protocol);
+    
+    /// Releases the port
+    void detach();
+    
+    /// Returns true if the port is open
+    bool isOpen();
+    
+    /// Returns the faults injected by the port since it was attached
+    dxl_fault_stats faults();
+    
+    /// Returns the port name, empty if it's not attached
+    inline QString port() const { return _port; }
+    
+    /// Returns the indexes of the bus servos in the robot vectors
+    inline const QVector<int>& servos() const { return _index; }
+    
+    /// Writes the servos ID, speed and compliance slope, only the changed
+    /// registers are sent. It's done in the calling thread
+    /// @param ID Contains the ID of all the robot servos
+    /// @param speed Speed from 0% to 100%
+    /// @param ccw Counter Clock Wise Compliance Slope
+    /// @param cw Clock Wise Compliance Slope
+    void setup(const QVector<int> &ID, double speed, uchar ccw, uchar cw);
+    
+    /// Starts reading the current position of the servos, the ones that
+    /// don't answer are read again one by one until the time limit
+    /// @pre The previous job has finished
+    /// @param retryUntil Time in ns when the retries must stop, 0 for none
+    void read(qint64 retryUntil = 0);
+    
+    /// Starts moving the servos, see AX12::moveTo()
+    /// @pre The previous job has finished
+    /// @param goal Contains the goal of all the robot servos
+    /// @param ratio Contains the speed fraction of all the robot servos
+    /// @param speed Speed of the servo with the longest move
+    void moveTo(const QVector<double> &goal, const QVector<double> &ratio,
+                double speed);
+    
+    /// Returns the speed fractions that make the first servos of a move
+    /// arrive at the same time, the others use the whole speed. They must
+    /// come from the start and the goal of the whole move, the distance 
+    /// still left in a cycle would crawl the servos that have almost arrived
+    /// @param from Contains the angles at the start of the move, negative 
+    /// if unknown and then the servo uses the whole speed
+    /// @param to Contains the goal angles
+    /// @param joints Number of servos that must arrive together
+    static QVector<double> speedRatios(const QVector<double> &from, 
+                                       const QVector<double> &to, 
+                                       int joints);
+    
+    /// Waits until the current job has finished
+    void finish();
+    
+    /// Copies the positions of the last read to the robot vectors
+    /// @pre The read has finished
+    /// @param pos Positions of all the robot servos, -1 if not read
+    /// @param time Time in ms when every position was received
+    void getPositions(QVector<double> &pos, QVector<double> &time) const;
+    
+    /// Copies the retries of the last read to the robot vectors
+    /// @pre The read has finished
+    /// @param retries Number of times every servo was read again
+    void getRetries(QVector<int> &retries) const;
+    
+    /// Starts the I/O thread, then the jobs are done in parallel with the
+    /// other buses
+    void startIO();
+    
+    /// Stops the I/O thread, the jobs are done by the calling thread
+    void stopIO();
+    
+private:
+    
+    /// Jobs of a cycle
+    enum Job {
+        None,
+        Read,
+        Move
+    };
+    
+    /// Shared port, NULL if it's not attached
+    dxl_bus *_bus;
+    
+    /// Port name
+    QString _port;
+    
+    /// Indexes of the servos in the robot vectors
+    QVector<int> _index;
+    
+    /// Contains the servos
+    QVector<AX12> _A;
+    
+    /// Last read positions and times
+    QVector<double> _pos, _time;
+    
+    /// Retries of the last read
+    QVector<int> _retries;
+    
+    /// Time in ns when the read retries must stop
+    qint64 _retryUntil;
+    
+    /// Goal positions and speed fractions of the move
+    QVector<double> _goal, _ratio;
+    
+    /// Speed of the move
+    double _speed;
+    
+    /// Pending job
+    Job _job;
+    
+    /// True when the I/O thread must end
+    bool _stop;
+    
+    /// Protects the job
+    QMutex _mutex;
+    
+    /// Wakes the I/O thread when there's a job
+    QWaitCondition _jobCond;
+    
+    /// Wakes the servo thread when the job has finished
+    QWaitCondition _doneCond;
+    
+    /// Gives a job to the I/O thread, or does it if the thread isn't running
+    void post(Job job);
+    
+    /// Does the pending job
+    void process();
+    
+    /// I/O thread
+    void run();
+};
+
+#endif // SERVOBUS_H
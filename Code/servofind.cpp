@@ -1,56 +1,122 @@
 #include "servofind.h"
 
-ServoFind::ServoFind() 
-{
+#include <QtConcurrent>
+
+/// Bytes added to the measured response time in the short timeouts
+#define FIND_MARGIN_BYTES   (4)
 
+ServoFind::ServoFind() :
+    _done(0),
+    _stop(0)
+{
+    
 }
 
 ServoFind::~ServoFind()
 {
-    
+    stop();
+    wait();
 }
 
 void ServoFind::run()
 {
-    QVector<int> data(_servo.size());
+    _done = 0;
+    _stop = 0;
+    if (_ports.isEmpty() or _bauds.isEmpty() or _min == _max) return;
+    
+    // The ports don't share anything, all of them are scanned at once
+    QStringList ports = _ports;
+    QtConcurrent::blockingMap(ports, [this](const QString &port) {
+        scan(port);
+    });
     
-    for (int i = 0; i < data.size(); ++i) 
-        data[i] = _servo[i]->currentData().toInt();
+    // The pings left by a port that can't be opened or by a stop aren't
+    // counted
+    emit completion(100);
+}
+
+void ServoFind::scan(const QString &port)
+{
+    int pings = _bauds.size()*(_max - _min);
+    int total = _ports.size()*pings;
     
-    for (QCB *s : _servo) {
-        s->clear();
-        s->addItem("None", -1);
+    // A port with the same servos as the last time isn't scanned, a ping 
+    // of every servo confirms it
+    if (_verify) {
+        ServoInventory inventory = _inventory;
+        if (inventory.verify(port, _protocol)) {
+            int done = _done.fetchAndAddOrdered(pings) + pings;
+            emit completion(100*done/total);
+            for (const ServoInventory::Servo &s : inventory.servos(port))
+                emit found(port, s.baud, s.ID, s.model, s.firmware);
+            return;
+        }
+        emit unconfirmed(port);
     }
     
-    int index = 1;
-    QVector<int> pos(_servo.size(), 0);
+    // The port is shared with the servo thread, every ping waits until the
+    // control loop leaves the bus
+    dxl_bus *bus = dxl_bus::attach(port, _bauds.first(), _protocol);
     
-    dynamixel dxl(_port, _baud);
+    // Response time in ms of the servos found, it's the adapter latency and
+    // the return delay so it doesn't depend on the baud rate. 0 until a
+    // servo answers
+    double response = 0;
     
-    for (int i = _min; i < _max; ++i) {
-        dxl.ping(i);
-        emit completion(((i - _min)/double(_max - _min))*100.0);
-        if (dxl.get_comm_result() == COMM_RXSUCCESS) {
-            
-            for (int j = 0; j < _servo.size(); ++j) {
-                if (data[j] == i) pos[j] = index;
-                _servo[j]->addItem(QString::number(i), i);
+    for (int baud : _bauds) {
+        for (int i = _min; i < _max and not _stop; ++i) {
+            bool answered;
+            int model, firmware;
+            {
+                dxl_bus_locker dxl(bus, dxl_bus::Scan);
+                if (not dxl->isOpen()) break;
+                
+                // The bus settings are restored for the other clients, with
+                // the group read they have learnt
+                dynamixel::settings old = dxl->save();
+                if (old.baudrate != baud) dxl->change_baudrate(baud);
+                dxl->set_protocol(_protocol);
+                
+                // Nobody else talks while the bus is locked, a servo answers
+                // in its response time or it isn't there. The fixed timeout
+                // is twice the latency
+                if (response > 0) {
+                    double bytes = FIND_MARGIN_BYTES*10000.0/baud;
+                    dxl->set_port_latency(response + bytes);
+                }
+                
+                // The model number and the firmware are for the inventory
+                answered = dxl->identify(i, model, firmware);
+                if (answered) {
+                    dxl_timing t = dxl->get_timing(i, INST_PING);
+                    response = qMax(response, t.mean);
+                }
+                
+                dxl->restore(old);
             }
             
-            ++index;
+            int done = _done.fetchAndAddOrdered(1) + 1;
+            emit completion(100*done/total);
+            if (answered) emit found(port, baud, i, model, firmware);
         }
     }
     
-    for (int i = 0; i < _servo.size(); ++i) _servo[i]->setCurrentIndex(pos[i]);
+    dxl_bus::detach(bus);
 }
 
-void ServoFind::setData(QVector<QComboBox *> servo, QString port, 
-                        int baud, int min, int max)
+void ServoFind::setData(const QStringList &ports, const QVector<int> &bauds,
+                        int min, int max, int protocol)
 {
     if (this->isRunning()) return;
-    _servo = servo;
-    _port = port;
-    _baud = baud;
+    
+    _ports.clear();
+    for (const QString &p : ports) {
+        if (not p.isEmpty() and not _ports.contains(p)) _ports.append(p);
+    }
+    
+    _bauds.clear();
+    for (int b : bauds) if (b > 0 and not _bauds.contains(b)) _bauds.append(b);
+    _protocol = protocol;
     
     if (min > max) {
         int aux = min;
@@ -64,6 +130,24 @@ void ServoFind::setData(QVector<QComboBox *> servo, QString port,
     
     _min = min;
     _max = max;
+    _verify = false;
 }
 
+void ServoFind::setInventory(const ServoInventory &inventory)
+{
+    if (this->isRunning()) return;
+    
+    _inventory = inventory;
+    _verify = true;
+}
 
+void ServoFind::stop()
+{
+    _stop = 1;
+}
+
+QVector<int> ServoFind::standardBauds()
+{
+    return QVector<int>({ 1000000, 500000, 400000, 250000, 200000, 115200,
+                          57600 });
+}
@@ -3,37 +3,81 @@
 
 #include "stable.h"
 #include "dxl/ax12.h"
+#include "dxl/dxl_bus.h"
+#include "servoinventory.h"
 
+/// Finds the servos connected to several ports, every port is scanned in
+/// its own thread at all the selected baud rates. An absent ID costs a
+/// whole receive timeout until a servo answers, then the response time of
+/// the port is known and the timeout is reduced to twice that time plus a
+/// few bytes. The servos found are given with the found() signal while the
+/// scan goes on. With an inventory the ports are confirmed first and only
+/// the ones with other servos are scanned
 class ServoFind : public QThread
 {
     Q_OBJECT
     
-    typedef QComboBox QCB;
 public:
     
     /// Default constructor
     ServoFind();
     
-    /// Default destructor
+    /// Default destructor, stops the scan
     ~ServoFind();
     
     /// Main function
     void run();
     
     /// To set all data
-    void setData(QVector<QComboBox *> servo, QString port, 
-                 int baud, int min = 0, int max = MAX_ID);
+    /// @param ports Ports to scan
+    /// @param bauds Baud rates to scan, in order
+    /// @param min First ID
+    /// @param max Last ID, not included
+    /// @param protocol Dynamixel protocol version, 1 or 2
+    void setData(const QStringList &ports, const QVector<int> &bauds,
+                 int min = 0, int max = MAX_ID, int protocol = 1);
     
+    /// Confirms the ports with the servos of an inventory before scanning
+    /// them, the servos of a confirmed port are given as found and it isn't
+    /// scanned. It must be called after setData()
+    /// @param inventory Servos expected, it's copied
+    void setInventory(const ServoInventory &inventory);
+    
+    /// Stops the scan, the thread ends after the current pings
+    void stop();
+    
+    /// Returns the baud rates of the AX-12 that a serial port can use, from
+    /// the fastest to the slowest
+    static QVector<int> standardBauds();
     
 signals:
     
     /// Shows the completion of the process
     void completion(int);
     
+    /// A servo has answered
+    /// @param port Port name
+    /// @param baud Baud rate
+    /// @param id Servo ID
+    /// @param model Model number, -1 if it couldn't be read
+    /// @param firmware Firmware version, -1 if it couldn't be read
+    void found(QString port, int baud, int id, int model, int firmware);
+    
+    /// The servos of a port aren't the ones of the inventory, it's scanned
+    /// and the servos found come after this signal
+    /// @param port Port name
+    void unconfirmed(QString port);
+    
 private:
     
-    /// Contains the baud rate
-    int _baud;
+    /// Contains the ports
+    QStringList _ports;
+    
+    /// Contains the baud rates
+    QVector<int> _bauds;
+    
+    /// Dynamixel protocol version
+    int _protocol = 1;
     
     /// Minimum value to find
     int _min = 0;
@@ -41,11 +85,20 @@ private:
     /// Maximum value to find
     int _max = MAX_ID;
     
-    /// Contains the current port
-    QString _port;
+    /// Servos expected in the ports
+    ServoInventory _inventory;
+    
+    /// True if the ports are confirmed with the inventory
+    bool _verify = false;
+    
+    /// Pings done by all the ports
+    QAtomicInt _done;
+    
+    /// True when the scan must end
+    QAtomicInt _stop;
     
-    /// Contains the pointer to the servos QComboBoxes
-    QVector<QComboBox *> _servo;    
+    /// Scans a port at all the baud rates
+    void scan(const QString &port);
 };
 
 #endif // SERVOFIND_H
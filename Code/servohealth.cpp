@@ -0,0 +1,72 @@
+/// @file servohealth.cpp Contains the ServoHealth class implementation
+#include "servohealth.h"
+
+/// Longest time in ms between two samples to measure the velocity
+#define HEALTH_SPEED_GAP    (100.0)
+
+ServoHealth::ServoHealth(int servos, int maxFailed, double horizon) :
+    _maxFailed(maxFailed),
+    _horizon(horizon),
+    _last(servos),
+    _stats(servos)
+{
+    reset();
+}
+
+bool ServoHealth::update(QVector<double> &pos, const QVector<double> &time,
+                         const QVector<int> &retries, double now)
+{
+    bool ok = true;
+    for (int i = 0; i < _last.size(); ++i) {
+        Sample &l = _last[i];
+        Stats &s = _stats[i];
+        ++s.cycles;
+        s.retries += retries[i];
+        
+        if (pos[i] >= 0) {
+            if (retries[i] > 0) ++s.recovered;
+            
+            // The velocity of samples too far apart isn't the current one
+            double dt = time[i] - l.time;
+            bool near = l.pos >= 0 and dt > 0 and dt < HEALTH_SPEED_GAP;
+            l.speed = near ? (pos[i] - l.pos)/dt : 0.0;
+            l.pos = pos[i];
+            l.time = time[i];
+            
+            s.state = Read;
+            s.age = qMax(0.0, now - l.time);
+            s.failed = 0;
+            continue;
+        }
+        
+        ++s.failures;
+        ++s.failed;
+        s.maxFailed = qMax(s.maxFailed, s.failed);
+        s.age = l.pos < 0 ? 0 : now - l.time;
+        
+        // A short extrapolation follows a moving servo, a longer one could
+        // go past its goal so the position is held after the horizon
+        if (l.pos >= 0) {
+            double t = qBound(0.0, s.age, _horizon);
+            pos[i] = qBound(0.0, l.pos + l.speed*t, 300.0);
+        }
+        
+        s.state = l.pos < 0 or s.failed > _maxFailed ? Lost : Estimated;
+        if (s.state == Lost) ok = false;
+    }
+    return ok;
+}
+
+void ServoHealth::reset()
+{
+    for (Sample &l : _last) {
+        l.pos = -1;
+        l.time = 0;
+        l.speed = 0;
+    }
+    for (Stats &s : _stats) {
+        s.state = Lost;
+        s.age = 0;
+        s.failed = 0;
+    }
+}
@@ -0,0 +1,89 @@
+/// @file servohealth.h Contains the ServoHealth class declaration
+#ifndef SERVOHEALTH_H
+#define SERVOHEALTH_H
+
+#include <QVector>
+
+/// The ServoHealth's class decides what the control loop does with the
+/// servos that couldn't be read. A position that is missing is estimated
+/// from the last good sample, moving it with the last measured velocity for
+/// a short time and holding it after that. When a servo fails too many
+/// cycles in a row the estimate isn't trusted anymore and the loop must
+/// stop the robot. The read failures of every servo are counted.
+class ServoHealth
+{
+public:
+    
+    /// State of a servo position
+    enum State {
+        Read,       ///< Read this cycle
+        Estimated,  ///< Estimated from the last good sample
+        Lost        ///< Too many failures, the robot must stop
+    };
+    
+    /// Contains the read statistics of a servo
+    struct Stats
+    {
+        State state;            ///< State of the last position
+        double age;             ///< Age in ms of the last good sample
+        int failed;             ///< Consecutive failed cycles
+        int maxFailed;          ///< Maximum consecutive failed cycles
+        quint64 cycles;         ///< Cycles the servo was read
+        quint64 failures;       ///< Cycles without a position
+        quint64 retries;        ///< Failed reads retried in the cycle
+        quint64 recovered;      ///< Retries that got the position
+        
+        /// Default constructor
+        Stats() : state(Lost), age(0), failed(0), maxFailed(0), cycles(0),
+            failures(0), retries(0), recovered(0) {}
+    };
+    
+    /// Initialization constructor
+    /// @param servos Number of servos
+    /// @param maxFailed Consecutive failed cycles before the servo is lost
+    /// @param horizon Longest extrapolation in ms
+    ServoHealth(int servos, int maxFailed = 10, double horizon = 30.0);
+    
+    /// Updates the statistics with the cycle read and replaces the missing
+    /// positions with their estimate
+    /// @param pos Servo positions, -1 if not read. The missing positions are
+    /// estimated, they stay -1 if the servo was never read
+    /// @param time Time in ms when every position was received
+    /// @param retries Retries of every servo in the cycle, see
+    /// ServoBus::getRetries()
+    /// @param now Current time in ms
+    /// @return False if any servo is lost
+    bool update(QVector<double> &pos, const QVector<double> &time,
+                const QVector<int> &retries, double now);
+    
+    /// Forgets the samples, the servos are lost until they are read again.
+    /// The counters are kept
+    void reset();
+    
+    /// Returns the statistics of a servo
+    inline const Stats& stats(int i) const { return _stats[i]; }
+    
+private:
+    
+    /// Last good samples of a servo
+    struct Sample
+    {
+        double pos;             ///< Position, -1 if never read
+        double time;            ///< Time in ms
+        double speed;           ///< Velocity in degrees/ms
+    };
+    
+    /// Consecutive failed cycles before a servo is lost
+    int _maxFailed;
+    
+    /// Longest extrapolation in ms
+    double _horizon;
+    
+    /// Contains the last good samples
+    QVector<Sample> _last;
+    
+    /// Contains the statistics
+    QVector<Stats> _stats;
+};
+
+#endif // SERVOHEALTH_H
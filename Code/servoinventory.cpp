@@ -0,0 +1,153 @@
+/// @file servoinventory.cpp Contains the ServoInventory class implementation
+#include "servoinventory.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QSerialPortInfo>
+
+#include "dxl/dxl_bus.h"
+
+QString ServoInventory::adapter(const QString &port)
+{
+    // The prefix selects the backend, the rest is the device
+    QSerialPortInfo info(port.mid(port.indexOf(':') + 1));
+    if (info.serialNumber().isEmpty()) return port;
+    
+    return QString::number(info.vendorIdentifier(), 16) + ":" +
+           QString::number(info.productIdentifier(), 16) + ":" +
+           info.serialNumber();
+}
+
+void ServoInventory::add(const QString &port, int baud, int ID, int model,
+                         int firmware)
+{
+    QString a = adapter(port);
+    int i = 0;
+    while (i < _servos.size() and
+           (_servos[i].adapter != a or _servos[i].ID != ID or
+            _servos[i].baud != baud)) ++i;
+    if (i == _servos.size()) _servos.push_back(Servo());
+    
+    Servo &s = _servos[i];
+    s.adapter = a;
+    s.port = port;
+    s.baud = baud;
+    s.ID = ID;
+    s.model = model;
+    s.firmware = firmware;
+    s.seen = QDateTime::currentMSecsSinceEpoch();
+}
+
+void ServoInventory::remove(const QString &port)
+{
+    QString a = adapter(port);
+    for (int i = _servos.size() - 1; i >= 0; --i) {
+        if (_servos[i].adapter == a) _servos.remove(i);
+    }
+}
+
+QVector<ServoInventory::Servo> ServoInventory::servos(const QString &port) const
+{
+    QString a = adapter(port);
+    QVector<Servo> S;
+    for (const Servo &s : _servos) if (s.adapter == a) S.push_back(s);
+    return S;
+}
+
+bool ServoInventory::verify(const QString &port, int protocol)
+{
+    QString a = adapter(port);
+    QVector<int> index;
+    for (int i = 0; i < _servos.size(); ++i) {
+        if (_servos[i].adapter == a) index.push_back(i);
+    }
+    if (index.isEmpty()) return false;
+    
+    // The port is shared with the servo thread, like a scan
+    dxl_bus *bus = dxl_bus::attach(port, _servos[index[0]].baud, protocol);
+    bool ok = true;
+    
+    // Usually all the servos have the same baud rate and the bus settings
+    // are changed once
+    while (ok and not index.isEmpty()) {
+        int baud = _servos[index[0]].baud;
+        QVector<int> group;
+        for (int i : index) if (_servos[i].baud == baud) group.push_back(i);
+        for (int i : group) index.removeOne(i);
+        
+        QVector<int> model(group.size(), -1), firmware(group.size(), -1);
+        {
+            dxl_bus_locker dxl(bus, dxl_bus::Scan);
+            if (not dxl->isOpen()) {
+                ok = false;
+                break;
+            }
+            
+            // The bus settings are restored for the other clients, with
+            // the group read they have learnt
+            dynamixel::settings old = dxl->save();
+            if (old.baudrate != baud) dxl->change_baudrate(baud);
+            dxl->set_protocol(protocol);
+            
+            // The AX-12 doesn't answer the group reads, every servo is
+            // pinged and the first that doesn't answer ends the check
+            for (int j = 0; j < group.size(); ++j) {
+                if (not dxl->identify(_servos[group[j]].ID, model[j],
+                                      firmware[j])) break;
+            }
+            
+            dxl->restore(old);
+        }
+        
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        for (int j = 0; j < group.size(); ++j) {
+            Servo &s = _servos[group[j]];
+            if (model[j] != s.model or firmware[j] != s.firmware) ok = false;
+            else {
+                s.port = port;
+                s.seen = now;
+            }
+        }
+    }
+    
+    dxl_bus::detach(bus);
+    return ok;
+}
+
+bool ServoInventory::load(QString file)
+{
+    _servos.clear();
+    
+    QFile f(file);
+    if (not f.open(QIODevice::ReadOnly)) return false;
+    QDataStream df(&f);
+    
+    int version, size;
+    df >> version;
+    if (version != Version::v_1_0) return false;
+    
+    df >> size;
+    QVector<Servo> S(qMax(0, size));
+    for (Servo &s : S) {
+        df >> s.adapter >> s.port >> s.baud >> s.ID >> s.model >> s.firmware
+           >> s.seen;
+    }
+    if (df.status() != QDataStream::Ok) return false;
+    
+    _servos = S;
+    return true;
+}
+
+bool ServoInventory::save(QString file) const
+{
+    QFile f(file);
+    if (not f.open(QIODevice::WriteOnly)) return false;
+    QDataStream df(&f);
+    
+    df << int(Version::v_1_0) << _servos.size();
+    for (const Servo &s : _servos) {
+        df << s.adapter << s.port << s.baud << s.ID << s.model << s.firmware
+           << s.seen;
+    }
+    return df.status() == QDataStream::Ok;
+}
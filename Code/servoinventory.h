@@ -0,0 +1,78 @@
+/// @file servoinventory.h Contains the ServoInventory class declaration
+#ifndef SERVOINVENTORY_H
+#define SERVOINVENTORY_H
+
+#include <QDataStream>
+#include <QString>
+#include <QVector>
+
+/// The ServoInventory's class remembers the servos found behind every serial
+/// adapter, so at startup a ping of every servo with its model and firmware
+/// confirms them instead of scanning all the IDs again. The adapters are
+/// known by their USB serial number, so the inventory follows an adapter
+/// plugged into another port; the ones without a serial number are known by
+/// the port name.
+class ServoInventory
+{
+public:
+    
+    /// Contains a servo of the inventory
+    struct Servo
+    {
+        QString adapter;    ///< Adapter identity, see adapter()
+        QString port;       ///< Port where it was last seen
+        int baud;           ///< Baud rate where it was last seen
+        int ID;             ///< Servo ID
+        int model;          ///< Model number
+        int firmware;       ///< Firmware version
+        qint64 seen;        ///< Last time seen in ms since the epoch
+        
+        /// Default constructor
+        Servo() : baud(0), ID(-1), model(0), firmware(0), seen(0) {}
+    };
+    
+    /// Returns the identity of the adapter connected to a port
+    /// @param port Port name, with or without the backend prefix
+    static QString adapter(const QString &port);
+    
+    /// Adds a servo found, or updates it if it was already there
+    /// @param port Port name
+    /// @param baud Baud rate
+    /// @param ID Servo ID
+    /// @param model Model number
+    /// @param firmware Firmware version
+    void add(const QString &port, int baud, int ID, int model, int firmware);
+    
+    /// Forgets the servos of the adapter connected to a port
+    void remove(const QString &port);
+    
+    /// Returns the servos of the adapter connected to a port
+    QVector<Servo> servos(const QString &port) const;
+    
+    /// Confirms the servos of the adapter connected to a port, every one is
+    /// identified with dynamixel::identify() at its baud rate
+    /// @param port Port name
+    /// @param protocol Dynamixel protocol version
+    /// @return False if there aren't servos or any of them doesn't answer
+    /// with the same model and firmware
+    bool verify(const QString &port, int protocol);
+    
+    /// Reads the inventory from a file
+    /// @return False if it can't be read, then the inventory is empty
+    bool load(QString file);
+    
+    /// Writes the inventory to a file
+    bool save(QString file) const;
+    
+private:
+    
+    /// Enum containing all the save file versions
+    enum Version {
+        v_1_0
+    };
+    
+    /// Contains the servos of all the adapters
+    QVector<Servo> _servos;
+};
+
+#endif // SERVOINVENTORY_H
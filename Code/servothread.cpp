@@ -2,14 +2,18 @@
 #include "servothread.h"
 
 ServoThread::ServoThread() :
-    _axis(0, 0, 0, 0),
-    _buts(XJoystick::ButtonCount),
-    _cBaud(9600),
-    _cPort("COM3"),
+    _axis(QVector4D(0, 0, 0, 0)),
+    _buts(0),
+    _cBaud(1000000),
+    _cPort(""),
     _dChanged(true),
     _end(false),
+    _ikD(4, qQNaN()),
+    _segRatio(4, -1),
+    _sentD(4, -1),
     _mod(Mode::Manual),
     _pause(true),
+    _rate(0),
     _sBaud(1000000),
     _servos(_sNum),
     _sPort("COM9"),
@@ -18,6 +22,9 @@ ServoThread::ServoThread() :
     _status(Status::begin)
 {
     for (Servo &s : _servos) s.ID = -1;
+    
+    // The mode changes are queued to the GUI thread
+    qRegisterMetaType<Mode>("Mode");
 }
 
 ServoThread::~ServoThread()
@@ -43,7 +50,7 @@ void ServoThread::read(QString file)
     
     int version;
     df >> version;
-    if (version != Version::v_1_0) {
+    if (version < Version::v_1_0 or version > Version::v_1_3) {
         emit statusBar("Error opening file", 2000);
         return;
     }
@@ -54,10 +61,42 @@ void ServoThread::read(QString file)
     df >> size;
     _servos.resize(size);
     for (Servo &s : _servos) df >> s.ID;
+    
+    // Control loop rate added in version 1.1
+    if (version >= Version::v_1_1) df >> _rate;
+    
+    // Servos protocol added in version 1.2, the servos are driven with 
+    // Protocol 1.0 until there's a control table for the 2.0 ones
+    if (version >= Version::v_1_2) {
+        int protocol;
+        df >> protocol;
+        if (protocol != 1 and protocol != 2) {
+            emit statusBar("Error opening file", 2000);
+            return;
+        }
+        if (protocol != servoProtocol) 
+            emit statusBar("Protocol 2.0 servos not supported", 2000);
+    }
+    
+    // The clamp port is used since version 1.3, the old files have a 
+    // default one that was never selected
+    if (version < Version::v_1_3) _cPort.clear();
     _dChanged = true;
     
 }
 
+void ServoThread::loadWorkspace(QString file)
+{
+    double xyMax = sqrt(workRadSq);
+    double zMax = workHeigh + 0.7;
+    
+    if (_grid.load(file, _kin, xyMax, 0.0, zMax, workRes)) return;
+    
+    _grid.build(_kin, xyMax, 0.0, zMax, workRes);
+    if (not _grid.save(file, _kin)) 
+        emit statusBar("Cannot store the workspace", 2000);
+}
+
 void ServoThread::readPath(QString file)
 {
     // Opening file for reading
@@ -76,7 +115,6 @@ void ServoThread::readPath(QString file)
     std::sort(temp.begin(), temp.end());
     
     _mutex.lock();
-    double sep = 0.6; // 0.5cm of separation
     QVector2D ori(posStart.toVector2D());
     
     _dominoe.clear();
@@ -92,20 +130,11 @@ void ServoThread::readPath(QString file)
         if (angle >= 180.0) angle -= 180.0;
         else if (angle >= 360.0) angle -= 360.0;
         
-        // Calculating direction vector
-        aux -= ori;
-        int steps = aux.length()/sep; 
-        
-        QVector<Dominoe> V(steps + 1);
-        
-        // Initial point
+        // Initial and final points, the trajectory between them is 
+        // generated when the robot moves
+        QVector<Dominoe> V(2);
         V[0] = Dominoe(ori, angle);
-        
-        // Adding intermediate positions
-        for (int j = 1; j <= steps; ++j){                
-            Dominoe dAux(j*aux/double(steps) + ori, angle);
-            V[j] = dAux;
-        }
+        V[1] = Dominoe(aux, angle);
         _dominoe.push_back(V);
     }
     _dChanged = true;
@@ -118,13 +147,18 @@ void ServoThread::readPath(QString file)
 
 void ServoThread::setData(QVector<float> &aV, QVector<bool> &buts)
 {
-    _mutex.lock();
     // Copying the joystick values
-    _axis = QVector4D(aV[0], aV[1], aV[2], aV[3]);
-    _axis.normalize();
-    _axis[3] *= 5;
-    for (int i = 0; i < buts.size(); ++i) _buts[i] |= buts[i];    
-    _mutex.unlock();
+    QVector4D &axis = _axis.back();
+    axis = QVector4D(aV[0], aV[1], aV[2], aV[3]);
+    axis.normalize();
+    axis[3] *= 5;
+    _axis.publish();
+    
+    quint32 mask = 0;
+    for (int i = 0; i < buts.size() and i < 32; ++i) {
+        if (buts[i]) mask |= 1u << i;
+    }
+    if (mask) _buts.fetchAndOrOrdered(mask);
 }
 
 void ServoThread::write(QString file)
@@ -137,9 +171,10 @@ void ServoThread::write(QString file)
     _mutex.lock();
     
     // Clamp and servos baud rate and port must be writen
-    df << int(Version::v_1_0) << _cBaud << _cPort << _sBaud << _sPort << _sSpeed
+    df << int(Version::v_1_3) << _cBaud << _cPort << _sBaud << _sPort << _sSpeed
        << _servos.size();    
     for (const Servo &s : _servos) df << s.ID;
+    df << _rate << servoProtocol;
     
     _mutex.unlock();
 }
@@ -149,15 +184,7 @@ bool ServoThread::isPosAvailable(const QVector4D &newPos)
     if (newPos.toVector2D().lengthSquared() > workRadSq) return false;
     if (newPos.z() > workHeigh + 0.7) return false;
     
-    QVector<double> D(4);
-    this->setAngles(newPos, D);
-    
-    for (int i = 0; i < 3; ++i) {
-        if (qIsNaN(D[i])) return false;
-        if (D[i] > maxAngle or D[i] < minAngle) return false;
-    }
-    
-    return true;
+    return _grid.isReachable(_kin, newPos.x(), newPos.y(), newPos.z());
 }
 
 bool ServoThread::isReady(const QVector<double> &S, 
@@ -176,13 +203,14 @@ void ServoThread::run()
     _mutex.lock();
     int sBaud = _sBaud;
     QString sPort = _sPort;
+    int cBaud = _cBaud;
+    QString cPort = _cPort;
+    LoopScheduler sched(_rate);
     _mutex.unlock();
     
-    // Serial port interface
-    dynamixel dxl(sPort, sBaud);
-    
-    // Contains the servos comunication
-    QVector<AX12> A(4);
+    // Contains the servos comunication, a bus for every port
+    QVector<ServoBus*> buses;
+    this->openBuses(buses, sPort, sBaud, cPort, cBaud);
     
     // Contains the servos ID
     QVector< int > ID(_sNum);
@@ -190,93 +218,169 @@ void ServoThread::run()
     // Contains the current servo data
     QVector< double > S(_sNum);
     
+    // Contains the time when every servo data was received
+    QVector< double > T(_sNum);
+    
+    // Contains the read retries of every servo
+    QVector< int > R(_sNum);
+    
+    // Estimates the servos that don't answer, the robot is stopped when 
+    // one of them is lost
+    ServoHealth health(_sNum, maxFailed, maxGuess);
+    bool stopped = false;
+    
     // Contains the servos angles
     QVector<double> D(4);
     D[3] = 150.0;
     
-    // First initialization
+    // First initialization, every register is written to all the servos 
+    // with a single packet
     _mutex.lock();
-    for (int i = 0; i < A.size(); ++i) {
-        A[i] = AX12(&dxl);  
-        A[i].setID(_servos[i].ID);
-        ID[i] = _servos[i].ID;
-        A[i].setSpeed(_sSpeed);
-        A[i].setComplianceSlope(ccwCS, cwCS);
-    }
+    for (int i = 0; i < _sNum; ++i) ID[i] = _servos[i].ID;
+    for (ServoBus *b : buses) b->setup(ID, _sSpeed, ccwCS, cwCS);
     _mutex.unlock();
     
     QVector4D pos(posIdle);
     QVector4D axis(0, 0, 0, 0);
-    QVector< bool > buts;
+    quint32 buts = 0;
     
     // Contains the domino number to put
     int dom = 0;
     int pas = 0;
     double speed = 100.0;
+    
+    // Speed of the servo with the longest move, the others are slower so 
+    // all of them arrive at the same time
+    double vel = speed;
     QVector< QVector< Dominoe > > Dom;
     
+    // Time in ns until the controlled mode must wait before continuing
+    qint64 hold = 0;
+    
+    // Trajectory to the current domino and its start time in ns
+    Trajectory traj;
+    qint64 trajStart = 0;
+    
     // Main while
     while (not _end) {
         
         // Pause
-        _mutex.lock();
-        if (not _end and _pause) {
-            dxl.terminate();
-            
-            // Thread pause
-            _cond.wait(&_mutex);
-            
-            if (_end) exit(0);
-            dxl.initialize(sPort, sBaud);
+        if (_pause) {
+            _mutex.lock();
+            if (not _end and _pause) {
+                this->closeBuses(buses);
+                
+                // Thread pause
+                _cond.wait(&_mutex);
+                
+                if (_end) exit(0);
+                this->openBuses(buses, sPort, sBaud, cPort, cBaud);
+                health.reset();
+                sched.restart();
+            }
+            _mutex.unlock();
         }
-        _mutex.unlock();
         
-        // Get current servo position
-        for (int i = 0; i < 3; ++i) S[i] = A[i].getCurrentPos();
-        if (_mod == Mode::Manual) S[3] = A[3].getCurrentPos();
+        sched.begin();
+        
+        // Get current servo position, a bus transaction in every port. The
+        // failed reads are retried in the first half of the I/O budget
+        qint64 now = dxl_clock::ns();
+        qint64 retryUntil = now + retryTime;
+        if (not sched.isFree()) 
+            retryUntil = qMin(retryUntil, (now + sched.ioDeadline())/2);
+        sched.beginIO();
+        this->readServos(buses, S, T, R, retryUntil);
+        sched.endIO();
+        
+        // The positions still missing are estimated, so a single failed read
+        // doesn't stop the controlled mode
+        bool lost = not health.update(S, T, R, dxl_clock::ns()/1000000.0);
+        
+        // Measured position, the commanded one if a servo was never read
+        QVector4D cur(pos);
+        if (S[0] < 0 or S[1] < 0 or S[2] < 0 or not _kin.forward(S, cur)) 
+            cur = pos;
         
         
         /*********** MUTEX ***********/
-        // Handling changes of data
-        _mutex.lock();
+        // Handling changes of data, the mutex is only taken when the GUI
+        // has changed something
         if (_dChanged) {
-            if (sPort != _sPort or sBaud != _sBaud) {
+            _mutex.lock();
+            if (sPort != _sPort or sBaud != _sBaud or cPort != _cPort or
+                cBaud != _cBaud) {
                 sPort = _sPort;
                 sBaud = _sBaud;
-                dxl.terminate();
-                dxl.initialize(sPort, sBaud);
-            }
-            for (int i = 0; i < S.size(); ++i) {
-                A[i].setID(_servos[i].ID);
-                ID[i] = _servos[i].ID;
-                A[i].setSpeed(_sSpeed);
-                A[i].setComplianceSlope(ccwCS, cwCS);
+                cPort = _cPort;
+                cBaud = _cBaud;
+                this->closeBuses(buses);
+                this->openBuses(buses, sPort, sBaud, cPort, cBaud);
+                health.reset();
             }
             
+            sched.beginIO();
+            
+            // Only the registers that have changed are written
+            for (int i = 0; i < S.size(); ++i) ID[i] = _servos[i].ID;
+            for (ServoBus *b : buses) b->setup(ID, _sSpeed, ccwCS, cwCS);
+            
             speed = _sSpeed;
+            vel = speed;
             Dom = _dominoe;
             dom = 0;
             pas = 0;
             pos = posIdle;            
             this->setAngles(pos, D);
-            this->setGoalPosition(ID, D, dxl);
+            this->moveServos(buses, ID, D, pos, vel);
+            sched.endIO();
+            
+            if (sched.getRate() != _rate) sched.setRate(_rate);
             _dChanged = false;
+            _mutex.unlock();
+        }
+        
+        // Joystick and buttons update, lock free
+        axis = _axis.read();
+        buts = _buts.fetchAndStoreOrdered(0);
+        
+        Telemetry &tel = _telemetry.back();
+        for (int i = 0; i < _sNum; ++i) {
+            tel.servo[i] = S[i];
+            tel.health[i] = health.stats(i);
+        }
+        tel.pos = cur;
+        tel.loop = sched.getStats();
+        _telemetry.publish();
+        
+        
+        // A servo that doesn't answer for too long stops the robot where it
+        // is, the controlled mode must be started again
+        if (lost != stopped) {
+            stopped = lost;
+            if (stopped) {
+                _mutex.lock();
+                _mod = Mode::Manual;
+                _mutex.unlock();
+                _status = Status::begin;
+                pos = cur;
+                emit modeChanged(Mode::Manual);
+                emit statusBar("Servo not answering, robot stopped in manual "
+                               "mode", -1);
+            }
+            else emit statusBar("Servos answering again", 2000);
         }
-
-        // Joystick and buttons update, must use mutex
-        for (int i = 0; i < _sNum; ++i) _servos[i].pos =  S[i];
-        axis = _axis;
-        buts = _buts;
-        for (bool &b : _buts) b = 0;
-        _pos = pos;
-        _mutex.unlock();
         
         
         /******** MODE ********/
         // Main function with data updated
         
+        ////// STOPPED //////
+        if (stopped) {
+            // Nothing moves until all the servos answer
+        }
         ////// MANUAL //////
-        if (_mod == Mode::Manual) {
+        else if (_mod == Mode::Manual) {
             QVector4D posAux = pos + 0.5*axis;
             if (posAux[3] < 0) posAux[3] = 0;
             if (posAux[3] > 300.0) posAux[3] = 300.0;
@@ -286,44 +390,43 @@ void ServoThread::run()
             if (ok) pos = posAux;    
         } 
         ////// CONTROLLED //////
-        else if (_mod == Mode::Controlled) {
+        else if (_mod == Mode::Controlled and dxl_clock::ns() >= hold) {
             switch(_status) {
             case Status::begin:
-                for (AX12 &a : A) a.setSpeed(speed/10.0);
+                vel = speed/10.0;
                 pos = posStart;
                 if (this->isReady(S, pos, maxErr))  {
                     _status = Status::take;
-                    QThread::msleep(500);
+                    hold = dxl_clock::ns() + 500LL*1000000;
                 }
                 break;
                 
             case Status::take:
                 pos[2] = workHeigh;
                 if (this->isReady(S, pos, maxErr)) {
-                    for (AX12 &a : A) a.setSpeed(speed);
+                    vel = speed;
                     emit statusBar("Esperant peça", -1);
                     _status = Status::waiting;
                 }
                 break;
                 
             case Status::waiting:
-                if (buts[0]) {
+                if (buts & 1) {
                     pas = 0;
                     _status = Status::rotate;
                     emit statusBar("Girant!", -1);
                     
-                    for (AX12 &a : A) a.setSpeed(speed/3.5);
+                    vel = speed/3.5;
                 }
                 else break;
                 
             case Status::rotate:
             {
-                S[3] = A[3].getCurrentPos();
                 pos[3] = Dom[dom][0].ori;
                 double aux = abs(S[3] - Dom[dom][0].ori);
                 if (aux < maxErr) {
                     _status = Status::going;
-                    QThread::msleep(1000);
+                    hold = dxl_clock::ns() + 1000LL*1000000;
                     emit statusBar("Posicionant", -1);
                 }
             }
@@ -331,25 +434,33 @@ void ServoThread::run()
                 
             case Status::going:
             {
-                Dominoe &domi = Dom[dom][pas];
-                pos = QVector4D (domi.X, domi.Y, workHeigh, domi.ori);
+                // The setpoints are sampled from the trajectory, the 
+                // servos must be fast enough to follow them
+                if (pas == 0) {
+                    const Dominoe &from = Dom[dom].first();
+                    const Dominoe &to = Dom[dom].last();
+                    traj = this->trajectory(
+                                QVector4D(from.X, from.Y, workHeigh, from.ori),
+                                QVector4D(to.X, to.Y, workHeigh, to.ori), 
+                                speed);
+                    trajStart = dxl_clock::ns();
+                    pas = 1;
+                        
+                    vel = speed;
+                }
+                    
+                double t = (dxl_clock::ns() - trajStart)/1e9;
+                pos = traj.position(t);
                 if (pos.x() < 8.0) pos[2] = workHeigh + 0.3;
                 if (pos.x() < 7.5) pos[2] = workHeigh + 0.5;
                 if (pos.x() < 7.0) pos[2] = workHeigh + 0.6;
                 if (pos.x() < 2.0) pos[2] = workHeigh + 0.3;
-                double err;
-                pas == Dom[dom].size() - 1 ? err = maxErr : err = 2*maxErr;
-                
-                if (this->isReady(S, pos, err)) {
-                    ++pas;
-                    if (pas == Dom[dom].size()) {
-                        pas = 0;
-                        _status = Status::ending;
-                        QThread::msleep(200);
-                        emit statusBar("Col·locada", 1500);
-                        
-                        for (AX12 &a : A) a.setSpeed(speed);
-                    }
+                    
+                if (t >= traj.duration() and this->isReady(S, pos, maxErr)) {
+                    pas = 0;
+                    _status = Status::ending;
+                    hold = dxl_clock::ns() + 200LL*1000000;
+                    emit statusBar("Col·locada", 1500);
                 }
             }   
                 break;
@@ -361,7 +472,7 @@ void ServoThread::run()
                     ++pas;
                     if (pas == 4) {
                         _status = Status::begin;
-                        QThread::msleep(300);
+                        hold = dxl_clock::ns() + 300LL*1000000;
                         if (dom == Dom.size() - 1) {
                             dom = 0;
                             pas = 0;
@@ -371,10 +482,10 @@ void ServoThread::run()
                     }
                 }
                 break;
-            
+                
             default:
                 _status = Status::begin;
-            
+                
             }
         } 
         else if (_mod == Mode::Reset) {
@@ -383,65 +494,129 @@ void ServoThread::run()
             dom = 0;
         }
         
+        // Goal and speeds in one packet, nothing is sent if the servos 
+        // already have them. The setpoints streamed from a trajectory are 
+        // a single segment up to its end
+        bool streamed = _mod == Mode::Controlled and 
+                        _status == Status::going and pas == 1;
         this->setAngles(pos, D);
-        this->setGoalPosition(ID, D, dxl);
+        sched.beginIO();
+        this->moveServos(buses, ID, D, streamed ? traj.to() : pos, vel);
+        sched.endIO();
+        
+        // Sleeps until the next cycle in fixed rate mode
+        sched.wait();
     }
-    dxl.terminate();
+    this->closeBuses(buses);
     exit(0);
 }
 
-void ServoThread::setAngles(const QVector4D &pos, QVector<double> &D)
-{    
-    double x1 = pos.x() + L2 - L1;
-    double y1 = -pos.z();
-    double z1 = pos.y();
-    D[0] = singleAngle(x1,y1,z1);
-    
-    double x2 = pos.y()*sin60 - pos.x()*cos60 + L2 - L1;
-    double y2 = -pos.z();
-    double z2 = -pos.y()*cos60 - pos.x()*sin60;
-    D[1] = singleAngle(x2,y2,z2);
-    
-    double x3 = -pos.y()*sin60 - pos.x()*cos60 + L2 - L1;
-    double y3 = -pos.z();
-    double z3 = -pos.y()*cos60 + pos.x()*sin60;
-    D[2] = singleAngle(x3,y3,z3);
-    
-    for (double &d : D) d = 150.0 - d*180/M_PI;
-    D[3] = pos.w();
+void ServoThread::openBuses(QVector<ServoBus*> &buses, const QString &sPort, 
+                            int sBaud, const QString &cPort, int cBaud)
+{
+    // The arm servos are in the servos port, the wrist one is in the clamp
+    // port if it's selected
+    QVector<int> arm, wrist;
+    arm << 0 << 1 << 2;
+    wrist << 3;
+    
+    if (cPort.isEmpty() or cPort == sPort) {
+        buses.push_back(new ServoBus(arm + wrist));
+        buses.last()->attach(sPort, sBaud, servoProtocol);
+    }
+    else {
+        buses.push_back(new ServoBus(arm));
+        buses.last()->attach(sPort, sBaud, servoProtocol);
+        buses.push_back(new ServoBus(wrist));
+        buses.last()->attach(cPort, cBaud, servoProtocol);
+    }
+    
+    for (ServoBus *b : buses) {
+        if (not b->isOpen()) emit statusBar("Cannot open " + b->port(), 2000);
+    }
+    
+    // A single bus is driven by this thread, without any handoff
+    if (buses.size() > 1) for (ServoBus *b : buses) b->startIO();
 }
 
-void ServoThread::setGoalPosition(const QVector<int> &ID, 
-                                  const QVector<double> &pos, dynamixel &dxl)
+void ServoThread::closeBuses(QVector<ServoBus*> &buses)
 {
-    dxl.set_txpacket_id(BROADCAST_ID);
-    dxl.set_txpacket_instruction(INST_SYNC_WRITE);
-    dxl.set_txpacket_parameter(0, AX12::RAM::GoalPosition);
-    dxl.set_txpacket_parameter(1, 2);
-    
-    Q_ASSERT(ID.size() == pos.size());
-    for (int i = 0; i < ID.size(); ++i) {
-        unsigned int data = (pos[i]/300.0)*1023.0;
-        
-        dxl.set_txpacket_parameter(2 + 3*i, ID[i]);
-        dxl.set_txpacket_parameter(2 + 3*i + 1, LOBYTE(data));
-        dxl.set_txpacket_parameter(2 + 3*i + 2, HIBYTE(data));
+    for (ServoBus *b : buses) delete b;
+    buses.clear();
+}
+
+void ServoThread::readServos(QVector<ServoBus*> &buses, QVector<double> &S,
+                             QVector<double> &T, QVector<int> &R, 
+                             qint64 retryUntil)
+{
+    for (ServoBus *b : buses) b->read(retryUntil);
+    
+    // Cycle barrier, the positions are complete when all the buses finish
+    for (ServoBus *b : buses) {
+        b->finish();
+        b->getPositions(S, T);
+        b->getRetries(R);
     }
-    dxl.set_txpacket_length(4 + 3*ID.size());
-    dxl.txrx_packet();
 }
 
-double ServoThread::singleAngle(double x0, double y0, double z0)
+void ServoThread::moveServos(QVector<ServoBus*> &buses, const QVector<int> &ID,
+                             const QVector<double> &D, const QVector4D &goal,
+                             double speed)
 {
-    double n = b*b - a*a - z0*z0 - x0*x0 - y0*y0;
-    double raiz = sqrt (n*n*y0*y0 - 4*(x0*x0 + y0*y0)*(-x0*x0*a*a + n*n/4));
+    // The arm servos of all the buses must arrive at the same time, the 
+    // ratios of the lag left in every cycle would crawl the servos that 
+    // have almost arrived
+    if (goal != _segGoal) {
+        QVector<double> to(4);
+        _kin.inverse(goal, to);
+        _segRatio = ServoBus::speedRatios(_sentD, to, 3);
+        _segGoal = goal;
+    }
     
-    if (x0 < 0) raiz *= -1;
-    double y = (-n*y0 + raiz ) / (2*(x0*x0 + y0*y0));
+    for (ServoBus *b : buses) b->moveTo(D, _segRatio, speed);
+    for (ServoBus *b : buses) b->finish();
     
-    int signe = 1;
-    if ((b*b - (y0 + a)*(y0 + a)) < (x0*x0 + z0*z0) && x0 < 0) signe *= -1;
-    double x = sqrt(a*a - y*y)*signe;
-    return atan2 (y,x);
+    for (int i = 0; i < 4; ++i) {
+        if (ID[i] >= 0 and not qIsNaN(D[i])) _sentD[i] = D[i];
+    }
 }
 
+void ServoThread::setAngles(const QVector4D &pos, QVector<double> &D)
+{    
+    if (pos != _ikPos or qIsNaN(_ikD[0])) {
+        _kin.inverse(pos, _ikD);
+        _ikPos = pos;
+    }
+    
+    for (int i = 0; i < 4; ++i) D[i] = _ikD[i];
+}
+
+Trajectory ServoThread::trajectory(const QVector4D &from, const QVector4D &to,
+                                  double speed)
+{
+    double L = (to.toVector3D() - from.toVector3D()).length();
+    
+    // Servo limits in degrees
+    double w = servoSpeed*speed/100.0;
+    double alpha = w/servoAccelTime;
+    double jerk = alpha/servoJerkTime;
+    
+    // Maximum servo displacement for every cm along the path, the 
+    // cartesian limits are the servo limits divided by it
+    const double ds = 0.01;
+    QVector<double> D0(4), D1(4);
+    double k = 0;
+    for (int i = 0; i <= 10 and L > 0; ++i) {
+        QVector4D p = from + (to - from)*(i/10.0);
+        _kin.inverse(p, D0);
+        _kin.inverse(p + (to - from)*(ds/L), D1);
+        
+        for (int j = 0; j < 4; ++j) {
+            double d = qAbs(D1[j] - D0[j])/ds;
+            if (not qIsNaN(d) and d > k) k = d;
+        }
+    }
+    if (k <= 0) k = 1;
+    
+    return Trajectory(from, to, w/k, alpha/k, jerk/k);
+}
@@ -7,6 +7,13 @@
 
 // User libraries
 #include "dxl/ax12.h"
+#include "kinematics.h"
+#include "loopscheduler.h"
+#include "servobus.h"
+#include "servohealth.h"
+#include "trajectory.h"
+#include "triplebuffer.h"
+#include "workspacegrid.h"
 #include <QVector>
 
 #undef M_PI
@@ -18,10 +25,15 @@ class ServoThread : public QThread
 {
     Q_OBJECT
     
+    static const int _sNum = 4;     ///< Number of servos to manage
+    
     /// Enum containing all the save file versions
     enum Version 
     {
-        v_1_0
+        v_1_0,
+        v_1_1,
+        v_1_2,
+        v_1_3
     };
     
     /// Contains the available status for the Controlled mode
@@ -98,6 +110,21 @@ public:
         Reset
     };
     
+    /// Snapshot of the servo loop state, published every cycle
+    struct Telemetry
+    {
+        double servo[_sNum];        ///< Servos position, -1 if not read
+        ServoHealth::Stats health[_sNum];   ///< Servos read statistics
+        QVector4D pos;              ///< Position measured from the servos
+        LoopScheduler::Stats loop;  ///< Control loop timing statistics
+        
+        /// Default constructor
+        Telemetry() : pos(0, 0, 0, 0)
+        {
+            for (double &s : servo) s = -1;
+        }
+    };
+    
     /// Default constructor
     ServoThread();
     
@@ -115,13 +142,30 @@ public:
         wait();
     }
     
-    /// Returns the current position
-    inline QVector4D getCurrentPos()
+    /// Returns the current position measured from the servos angles
+    /// @pre Called from the GUI thread, like all the telemetry getters
+    inline QVector4D getCurrentPos() { return _telemetry.read().pos; }
+    
+    /// Returns the duration of the last control loop cycle in ns
+    inline qint64 getCycleTime() { return _telemetry.read().loop.cycle; }
+    
+    /// Returns the control loop timing statistics
+    inline LoopScheduler::Stats getLoopStats() 
+    { 
+        return _telemetry.read().loop; 
+    }
+    
+    /// Returns the control loop rate in Hz, 0 if it's free running
+    inline int getRate()
     {
         QMutexLocker m(&_mutex);
-        return _pos;
+        return _rate;
     }
     
+    /// Returns the Dynamixel protocol version used with the servos, the AX12
+    /// class only knows the Protocol 1.0 control table of the AX-12
+    inline int getServoProtocol() const { return servoProtocol; }
+    
     /// Returns the current servo Baud rate
     inline int getServoBaud()
     {
@@ -136,6 +180,15 @@ public:
         return _sPort;
     }
     
+    /// Returns both clamp Port and baud Rate
+    inline void getClampPortInfo(QString &port, int &baud)
+    {
+        _mutex.lock();
+        baud = _cBaud;
+        port = _cPort;
+        _mutex.unlock();
+    }
+    
     /// Returns both servo Port and baud Rate
     inline void getServoPortInfo(QString &port, int &baud)
     {
@@ -152,15 +205,23 @@ public:
         _mutex.lock();
         V = _servos;
         _mutex.unlock();
+        
+        const Telemetry &t = _telemetry.read();
+        for (int i = 0; i < V.size() and i < _sNum; ++i) V[i].pos = t.servo[i];
     }
     
     /// Overloaded function to get the servo info
     inline QVector<Servo> getServosInfo()
     {
-        QMutexLocker mL(&_mutex);
-        return _servos;
+        QVector<Servo> V;
+        getServosInfo(V);
+        return V;
     }
     
+    /// Returns the last snapshot of the servo loop, it never waits for it
+    /// @pre Called from the GUI thread
+    inline const Telemetry& getTelemetry() { return _telemetry.read(); }
+    
     /// Returns the number of servos to handle
     inline int getServosNum() { return _sNum; }
     
@@ -193,6 +254,12 @@ public:
     /// @param file Path to the selected file
     void read(QString file);
     
+    /// Loads the workspace grid from the selected file, if it doesn't exist 
+    /// or it was built with another geometry it's built and stored again
+    /// @pre The thread is not running
+    /// @param file Path to the grid file
+    void loadWorkspace(QString file);
+    
     /// Reads the path where to put the selected pieces
     /// @param file Path to the file where to read the pieces
     void readPath(QString file);
@@ -218,11 +285,38 @@ public:
         _dChanged = true;
     }
     
-    /// Adds the loaded data
+    /// Sets the control loop rate
+    /// @param rate Rate in Hz, 0 to run the loop as fast as possible
+    inline void setRate(int rate)
+    {
+        if (rate < 0) rate = 0;
+        
+        _mutex.lock();
+        _rate = rate;
+        _dChanged = true;
+        _mutex.unlock();
+    }
+    
+    /// Adds the loaded data, it never waits for the servo loop
+    /// @pre Called from the GUI thread
     /// @param aV Contains the axis values
-    /// @param buts Contains the buttons values
+    /// @param buts Contains the buttons values, a pressed button is kept 
+    /// until the servo loop reads it
     void setData(QVector< float > &aV, QVector<bool> &buts);
     
+    /// Sets the clamp port info, the wrist servo is moved to this port if 
+    /// it's different from the servos one
+    /// @param port String containing the selected port, empty if not used
+    /// @param baud Contains the selected baud rate
+    inline void setClampPortInfo(QString &port, unsigned int baud)
+    {
+        _mutex.lock();
+        _cPort = port;
+        _cBaud = baud;
+        _dChanged = true;
+        _mutex.unlock();
+    }
+    
     /// Sets the servos port baud rate
     /// @param baud Positive number containing the baud rate
     inline void setServoBaud(unsigned int baud)
@@ -308,22 +402,22 @@ signals:
     
 private:
     
-    const double cos60 = 0.5;       ///< Contains the cosinus of 60
-    const double sin60 = sqrt(3)/2; ///< Contains the sinus of 60
-    const double a = 11.6;        ///< The arm length
-    const double b = 22.648;        ///< The forearm length
-    const double L1 = 5.499;        ///< The base center length
-    const double L2 = 6.000;        ///< The clamp support center lenght
     const double maxErr = 3.0;      ///< Max available error
-    const double minAngle = 126.0;   ///< Minimum servo angle
-    const double maxAngle = 240.0;  ///< Maximum servo angle
     const double workRadSq = 144.0; ///< Working radius squared
+    const double workRes = 0.2;     ///< Workspace grid voxel size
     
-    const uchar ccwCS = 2;          ///< The Counter Clock Wise Compliance Slope
-    const uchar cwCS = 2;           ///< The Clock Wise Compliance Slope
+    const double servoSpeed = 684.0;    ///< Servo max speed in degrees/s
+    const double servoAccelTime = 0.15; ///< Time to reach the max speed
+    const double servoJerkTime = 0.05;  ///< Time to reach the max accel
     
-    static const int _sNum = 4;     ///< Number of servos to manage
+    const int servoProtocol = 1;    ///< Protocol of the AX-12 table
+    
+    const int maxFailed = 10;       ///< Failed reads before stopping
+    const double maxGuess = 30.0;   ///< Longest extrapolation in ms
+    const qint64 retryTime = 10000000;  ///< Longest read retries in ns
     
+    const uchar ccwCS = 2;          ///< The Counter Clock Wise Compliance Slope
+    const uchar cwCS = 2;           ///< The Clock Wise Compliance Slope
     
     /// Working heigh
     const double workHeigh = 23.3;
@@ -338,44 +432,70 @@ private:
     /// Idle position
     const QVector4D posIdle = QVector4D(0.0f, 0.0f, idleHeigh, 150);
     
-    /// Contains the axis value
-    QVector4D _axis;
+    /// Contains the last axis value sent by the GUI
+    TripleBuffer<QVector4D> _axis;
     
-    /// Contains the buttons value
-    QVector < bool > _buts;
+    /// Contains the buttons pressed since the last cycle, one bit per button
+    QAtomicInteger<quint32> _buts;
     
-    /// Contains the baud rate used to comunicate with the clamp
+    /// Contains the baud rate used to comunicate with the clamp and the
+    /// wrist servo
     int _cBaud;
     
     /// To start and pause the thread
     QWaitCondition _cond;
         
-    /// Contains the selected com port used to comunitate with the clamp
+    /// Contains the selected com port used to comunitate with the clamp and
+    /// the wrist servo, empty if they share the servos port
     QString _cPort;
     
-    /// True if the data changes
-    bool _dChanged;
+    /// True if the data changes, it can be tested without the mutex but it 
+    /// must be changed with it
+    QAtomicInt _dChanged;
     
     /// Contains all the dominoes information
     QVector< QVector< Dominoe > > _dominoe;
     
     /// True when we must end executino
-    bool _end;
+    QAtomicInt _end;
     
     /// True if the enter key is pressed
     bool _enter;
     
+    /// Last position solved by setAngles(), only used by the servo thread
+    QVector4D _ikPos;
+    
+    /// Servos angles of the last position solved by setAngles()
+    QVector<double> _ikD;
+    
+    /// Goal of the segment followed by moveServos(), only used by the servo
+    /// thread
+    QVector4D _segGoal;
+    
+    /// Speed fractions of the servos for the current segment
+    QVector<double> _segRatio;
+    
+    /// Last goal angles sent, the start of the next segment
+    QVector<double> _sentD;
+    
+    /// Contains the robot geometry and kinematics
+    Kinematics _kin;
+    
+    /// Precomputed workspace used to check the positions
+    WorkspaceGrid _grid;
+    
     /// Contains the working mode
     Mode _mod;
     
     /// To prevent memory errors between threads
     QMutex _mutex;
     
-    /// Pauses the execution of the thread
-    bool _pause;
+    /// Pauses the execution of the thread, it can be tested without the 
+    /// mutex but it must be changed with it
+    QAtomicInt _pause;
     
-    /// Contains the current position to show to the window
-    QVector4D _pos;
+    /// Control loop rate in Hz, 0 if free running
+    int _rate;
     
     /// Contains the used baud rate to comunicate with the servos
     int _sBaud;
@@ -395,23 +515,69 @@ private:
     /// Current status
     Status _status;
     
+    /// Servo loop state shown by the window
+    TripleBuffer<Telemetry> _telemetry;
+    
+    /// Releases the servos ports
+    void closeBuses(QVector<ServoBus*> &buses);
+    
     /// Returns true if the position is available
     bool isPosAvailable(const QVector4D &newPos);
     
     bool isReady(const QVector<double> &S, const QVector4D &pos, double err);
     
+    /// Moves the servos of all the buses, see AX12::moveTo(). The arm 
+    /// servos arrive together at the goal of the segment, their speeds are
+    /// computed when it changes from the last angles sent and kept while it's
+    /// followed, the wrist uses the whole speed
+    /// @param buses Servos buses
+    /// @param ID Servos ID
+    /// @param D Goal angles of this cycle
+    /// @param goal Goal position of the segment, the end of the trajectory
+    /// or D's position when it's a single step
+    /// @param speed Speed of the servo with the longest move
+    void moveServos(QVector<ServoBus*> &buses, const QVector<int> &ID,
+                    const QVector<double> &D, const QVector4D &goal,
+                    double speed);
+    
+    /// Creates the buses of the servos, the arm servos are in the servos 
+    /// port and the wrist servo in the clamp port if it's selected and 
+    /// different, otherwise all of them share the servos port
+    /// @param buses Stores the buses
+    /// @param sPort Servos port
+    /// @param sBaud Servos port baud rate
+    /// @param cPort Clamp port, empty if not used
+    /// @param cBaud Clamp port baud rate
+    void openBuses(QVector<ServoBus*> &buses, const QString &sPort, int sBaud,
+                   const QString &cPort, int cBaud);
+    
+    /// Reads the position of all the servos, every bus in parallel
+    /// @param buses Servos buses
+    /// @param S Stores the angles, -1 if not read
+    /// @param T Stores the time in ms when every angle was received
+    /// @param R Stores the retries of every servo
+    /// @param retryUntil Time in ns when the retries must stop
+    void readServos(QVector<ServoBus*> &buses, QVector<double> &S,
+                    QVector<double> &T, QVector<int> &R, qint64 retryUntil);
+    
     /// Used to create another thread
     void run();
     
-    /// Used to calculate the servos angles
+    /// Used to calculate the servos angles, the last solved position is
+    /// cached so solving the same target twice in a cycle is free
     void setAngles(const QVector4D &pos, 
                    QVector<double> &D);
     
-    void setGoalPosition(const QVector<int> &ID, const QVector<double> &pos, dynamixel &dxl);
-    
-    /// Calculates the angle of one servo in the selected position
-    double singleAngle(double x0, double y0, double z0);
+    /// Generates the trajectory between two positions with the cartesian
+    /// limits obtained from the servos limits
+    /// @param from Initial position
+    /// @param to Final position
+    /// @param speed Servo speed from 0% to 100%
+    Trajectory trajectory(const QVector4D &from, const QVector4D &to,
+                          double speed);
     
 };
 
+Q_DECLARE_METATYPE(ServoThread::Mode)
+
 #endif // SERVOTHREAD_H
@@ -0,0 +1,123 @@
+/// @file trajectory.cpp Contains the Trajectory class implementation
+#include "trajectory.h"
+
+#include <cmath>
+
+Trajectory::Trajectory() :
+    _L(0), _v(0), _a(0), _j(0), _Ta(0), _T(0)
+{
+    
+}
+
+Trajectory::Trajectory(const QVector4D &from, const QVector4D &to, 
+                       double vMax, double aMax, double jMax) :
+    _from(from),
+    _to(to),
+    _L((to.toVector3D() - from.toVector3D()).length()),
+    _v(vMax),
+    _a(aMax),
+    _j(jMax > 0 ? jMax : 0),
+    _Ta(0),
+    _T(0)
+{
+    if (_L <= 0 or _v <= 0 or _a <= 0) {
+        _L = 0;
+        return;
+    }
+    
+    // The maximum acceleration can't be reached before the maximum velocity
+    if (_j > 0 and _v*_j < _a*_a) _a = sqrt(_v*_j);
+    
+    // Short path, the maximum velocity can't be reached. The distance
+    // travelled accelerating and decelerating grows with the velocity so
+    // the reachable one is found with a bisection
+    if (_v*accelTime(_v) > _L) {
+        double lo = 0, hi = _v;
+        for (int i = 0; i < 60; ++i) {
+            double mid = (lo + hi)/2;
+            double a = _j > 0 ? qMin(_a, sqrt(mid*_j)) : _a;
+            double Ta = mid/a + (_j > 0 ? a/_j : 0);
+            if (mid*Ta > _L) hi = mid;
+            else lo = mid;
+        }
+        _v = lo;
+        if (_j > 0) _a = qMin(_a, sqrt(_v*_j));
+    }
+    
+    _Ta = accelTime(_v);
+    _T = 2*_Ta + (_L - _v*_Ta)/_v;
+}
+
+QVector4D Trajectory::position(double t) const
+{
+    if (_L <= 0) return _to;
+    
+    double s, v;
+    sample(t, s, v);
+    return _from + (_to - _from)*(s/_L);
+}
+
+double Trajectory::velocity(double t) const
+{
+    if (_L <= 0) return 0;
+    
+    double s, v;
+    sample(t, s, v);
+    return v;
+}
+
+double Trajectory::accelTime(double v) const
+{
+    return v/_a + (_j > 0 ? _a/_j : 0);
+}
+
+void Trajectory::accelPhase(double t, double &s, double &v) const
+{
+    // Jerk phases duration and constant acceleration phase duration
+    double Tj = _j > 0 ? _a/_j : 0;
+    double Tc = _Ta - 2*Tj;
+    
+    double v1 = _j*Tj*Tj/2;
+    double s1 = _j*Tj*Tj*Tj/6;
+    
+    if (t < Tj) {
+        v = _j*t*t/2;
+        s = _j*t*t*t/6;
+    }
+    else if (t < Tj + Tc) {
+        t -= Tj;
+        v = v1 + _a*t;
+        s = s1 + v1*t + _a*t*t/2;
+    }
+    else {
+        double v2 = v1 + _a*Tc;
+        double s2 = s1 + v1*Tc + _a*Tc*Tc/2;
+        t -= Tj + Tc;
+        v = v2 + _a*t - _j*t*t/2;
+        s = s2 + v2*t + _a*t*t/2 - _j*t*t*t/6;
+    }
+}
+
+void Trajectory::sample(double t, double &s, double &v) const
+{
+    if (t <= 0) {
+        s = v = 0;
+    }
+    else if (t >= _T) {
+        s = _L;
+        v = 0;
+    }
+    else if (t < _Ta) {
+        accelPhase(t, s, v);
+    }
+    else if (t <= _T - _Ta) {
+        // Cruise, the acceleration phase travels v*Ta/2
+        v = _v;
+        s = _v*_Ta/2 + _v*(t - _Ta);
+    }
+    else {
+        // The deceleration is symmetric to the acceleration
+        accelPhase(_T - t, s, v);
+        s = _L - s;
+    }
+}
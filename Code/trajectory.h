@@ -0,0 +1,84 @@
+/// @file trajectory.h Contains the Trajectory class declaration
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+
+#include <QVector4D>
+
+/// The Trajectory's class generates a time parameterized straight line 
+/// motion between two positions. The motion follows an S-curve profile 
+/// limited in velocity, acceleration and jerk, if the jerk limit is 0 the
+/// profile is trapezoidal. The rotation (w) is interpolated with the same 
+/// profile as the X, Y, Z position.
+class Trajectory
+{
+public:
+    
+    /// Default constructor, empty trajectory
+    Trajectory();
+    
+    /// Initialization constructor
+    /// @param from Initial position
+    /// @param to Final position
+    /// @param vMax Maximum velocity in cm/s
+    /// @param aMax Maximum acceleration in cm/s²
+    /// @param jMax Maximum jerk in cm/s³, 0 for a trapezoidal profile
+    Trajectory(const QVector4D &from, const QVector4D &to, 
+               double vMax, double aMax, double jMax = 0);
+    
+    /// Returns the total duration in s
+    inline double duration() const { return _T; }
+    
+    /// Returns the path length in cm
+    inline double length() const { return _L; }
+    
+    /// Returns the final position
+    inline const QVector4D& to() const { return _to; }
+    
+    /// Returns the position at the selected time
+    /// @param t Time in s from the beginning of the motion
+    QVector4D position(double t) const;
+    
+    /// Returns the velocity along the path at the selected time in cm/s
+    /// @param t Time in s from the beginning of the motion
+    double velocity(double t) const;
+    
+private:
+    
+    /// Initial position
+    QVector4D _from;
+    
+    /// Final position
+    QVector4D _to;
+    
+    /// Path length
+    double _L;
+    
+    /// Reached velocity
+    double _v;
+    
+    /// Reached acceleration
+    double _a;
+    
+    /// Used jerk, 0 if trapezoidal
+    double _j;
+    
+    /// Duration of each acceleration or deceleration phase
+    double _Ta;
+    
+    /// Total duration
+    double _T;
+    
+    /// Returns the acceleration phase duration for the selected velocity
+    double accelTime(double v) const;
+    
+    /// Computes the distance and velocity in the acceleration phase
+    /// @param t Time from the beginning of the phase
+    /// @param s Stores the travelled distance
+    /// @param v Stores the velocity
+    void accelPhase(double t, double &s, double &v) const;
+    
+    /// Computes the distance and velocity along the path
+    void sample(double t, double &s, double &v) const;
+};
+
+#endif // TRAJECTORY_H
@@ -0,0 +1,81 @@
+/// @file triplebuffer.h Contains the TripleBuffer class declaration
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+/// The TripleBuffer's class exchanges the latest value of some data between
+/// one writer thread and one reader thread without locks. The writer fills
+/// its own buffer and publishes it swapping it with the middle one, the
+/// reader takes the middle one only if there's something new, so neither of
+/// them ever waits for the other and the reader always gets a complete value
+template<class T>
+class TripleBuffer
+{
+public:
+    
+    /// Default constructor
+    /// @param init Initial value of all the buffers
+    TripleBuffer(const T &init = T()) :
+        _back(0),
+        _front(1),
+        _state(2)
+    {
+        for (T &b : _buf) b = init;
+    }
+    
+    /// Returns the buffer to be filled by the writer
+    inline T& back() { return _buf[_back]; }
+    
+    /// Publishes the back buffer, a value not read yet is discarded
+    inline void publish()
+    {
+        _back = _state.fetchAndStoreOrdered(_back | Fresh) & Index;
+    }
+    
+    /// Copies the value to the back buffer and publishes it
+    inline void write(const T &value)
+    {
+        _buf[_back] = value;
+        publish();
+    }
+    
+    /// Takes the last published value if there's a new one
+    /// @return True if the value has changed since the last call
+    inline bool update()
+    {
+        if (not (_state.loadAcquire() & Fresh)) return false;
+        _front = _state.fetchAndStoreOrdered(_front) & Index;
+        return true;
+    }
+    
+    /// Returns the last published value
+    inline const T& read()
+    {
+        update();
+        return _buf[_front];
+    }
+    
+private:
+    
+    /// Bits of the shared state
+    enum State
+    {
+        Index = 3,  ///< Index of the middle buffer
+        Fresh = 4   ///< The middle buffer hasn't been read
+    };
+    
+    /// Contains the three buffers
+    T _buf[3];
+    
+    /// Buffer owned by the writer
+    int _back;
+    
+    /// Buffer owned by the reader
+    int _front;
+    
+    /// Middle buffer index and fresh flag
+    QAtomicInt _state;
+};
+
+#endif // TRIPLEBUFFER_H
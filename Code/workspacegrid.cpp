@@ -0,0 +1,168 @@
+/// @file workspacegrid.cpp Contains the WorkspaceGrid class implementation
+#include "workspacegrid.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QTextStream>
+#include <QVector>
+#include <QtConcurrent>
+
+WorkspaceGrid::WorkspaceGrid() :
+    _inv(1),
+    _nx(0),
+    _nz(0),
+    _res(1),
+    _x0(0),
+    _z0(0)
+{
+    
+}
+
+void WorkspaceGrid::build(const Kinematics &k, double xyMax, double zMin, 
+                          double zMax, double res, QVector<uchar> *nodes)
+{
+    _res = res;
+    _inv = 1.0/res;
+    _x0 = -xyMax;
+    _z0 = zMin;
+    _nx = int(ceil(2*xyMax/res));
+    _nz = int(ceil((zMax - zMin)/res));
+    if (nodes) nodes->clear();
+    
+    // Reachability of every node, there's one more node than voxels. The Z 
+    // slices are solved in parallel and every row at once with the batched
+    // inverse kinematics, one byte per node so the threads don't share bits
+    int nx = _nx + 1, nz = _nz + 1;
+    QVector<uchar> node(nx*nx*nz);
+    QVector<int> slices(nz);
+    for (int iz = 0; iz < nz; ++iz) slices[iz] = iz;
+    
+    double x0 = _x0, z0 = _z0;
+    uchar *out = node.data();
+    QtConcurrent::blockingMap(slices, [&k, nx, x0, z0, res, out](int iz) {
+        QVector<double> X(nx), Y(nx), Z(nx, z0 + iz*res);
+        QVector<double> D0(nx), D1(nx), D2(nx);
+        for (int ix = 0; ix < nx; ++ix) X[ix] = x0 + ix*res;
+        
+        for (int iy = 0; iy < nx; ++iy) {
+            Y.fill(x0 + iy*res);
+            k.inverse(nx, X.constData(), Y.constData(), Z.constData(), 
+                      D0.data(), D1.data(), D2.data(), 
+                      out + (iz*nx + iy)*nx);
+        }
+    });
+    
+    _inside = QBitArray(_nx*_nx*_nz);
+    _boundary = QBitArray(_nx*_nx*_nz);
+    for (int iz = 0; iz < _nz; ++iz) {
+        for (int iy = 0; iy < _nx; ++iy) {
+            for (int ix = 0; ix < _nx; ++ix) {
+                int count = 0;
+                for (int c = 0; c < 8; ++c) {
+                    int n = ((iz + (c >> 2))*nx + iy + ((c >> 1) & 1))*nx 
+                            + ix + (c & 1);
+                    if (node[n]) ++count;
+                }
+                
+                int i = (iz*_nx + iy)*_nx + ix;
+                if (count == 8) _inside.setBit(i);
+                else if (count > 0) _boundary.setBit(i);
+            }
+        }
+    }
+    
+    if (nodes) nodes->swap(node);
+}
+
+bool WorkspaceGrid::isReachable(const Kinematics &k, 
+                                double x, double y, double z) const
+{
+    if (not isEmpty()) {
+        State s = state(x, y, z);
+        if (s == Inside) return true;
+        if (s == Outside) return false;
+    }
+    return k.isReachable(x, y, z);
+}
+
+bool WorkspaceGrid::load(QString file, const Kinematics &k, double xyMax, 
+                         double zMin, double zMax, double res)
+{
+    QFile f(file);
+    if (not f.open(QIODevice::ReadOnly)) return false;
+    QDataStream df(&f);
+    
+    int version;
+    QVector<double> sig;
+    df >> version;
+    if (version != Version::v_1_0) return false;
+    
+    df >> sig;
+    if (sig != signature(k, xyMax, zMin, zMax, res)) return false;
+    
+    WorkspaceGrid g;
+    df >> g._nx >> g._nz >> g._inside >> g._boundary;
+    if (df.status() != QDataStream::Ok) return false;
+    if (g._inside.size() != g._nx*g._nx*g._nz) return false;
+    if (g._boundary.size() != g._inside.size()) return false;
+    
+    g._res = res;
+    g._inv = 1.0/res;
+    g._x0 = -xyMax;
+    g._z0 = zMin;
+    *this = g;
+    return true;
+}
+
+bool WorkspaceGrid::save(QString file, const Kinematics &k) const
+{
+    QFile f(file);
+    if (not f.open(QIODevice::WriteOnly)) return false;
+    QDataStream df(&f);
+    
+    df << int(Version::v_1_0) 
+       << signature(k, -_x0, _z0, _z0 + _nz*_res, _res)
+       << _nx << _nz << _inside << _boundary;
+    return df.status() == QDataStream::Ok;
+}
+
+bool WorkspaceGrid::savePoints(QString file, const QVector<uchar> &nodes) const
+{
+    int nx = _nx + 1, nz = _nz + 1;
+    if (nodes.size() != nx*nx*nz) return false;
+    
+    QFile f(file);
+    if (not f.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    QTextStream tf(&f);
+    
+    // Enough decimals to tell the nodes apart, at least 2 like the old file
+    int decimals = qMax(2, int(ceil(-log10(_res) - 1e-9)));
+    tf.setRealNumberNotation(QTextStream::FixedNotation);
+    tf.setRealNumberPrecision(decimals);
+    
+    // Same order as the Matlab script, Z then X then Y
+    for (int iz = 0; iz < nz; ++iz) {
+        double z = _z0 + iz*_res;
+        for (int ix = 0; ix < nx; ++ix) {
+            double x = _x0 + ix*_res;
+            for (int iy = 0; iy < nx; ++iy) {
+                if (not nodes[(iz*nx + iy)*nx + ix]) continue;
+                tf << x << ' ' << _x0 + iy*_res << ' ' << z << '\n';
+            }
+        }
+    }
+    tf.flush();
+    return tf.status() == QTextStream::Ok;
+}
+
+QVector<double> WorkspaceGrid::signature(const Kinematics &k, double xyMax, 
+                                         double zMin, double zMax, double res)
+{
+    // The Z range is rounded to whole voxels when the grid is built
+    double nz = ceil((zMax - zMin)/res);
+    
+    QVector<double> sig;
+    sig << k.a << k.b << k.L1 << k.L2 << k.minAngle << k.maxAngle
+        << xyMax << zMin << nz << res;
+    return sig;
+}
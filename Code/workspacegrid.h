@@ -0,0 +1,132 @@
+/// @file workspacegrid.h Contains the WorkspaceGrid class declaration
+#ifndef WORKSPACEGRID_H
+#define WORKSPACEGRID_H
+
+#include <QBitArray>
+#include <QString>
+#include <QVector>
+
+#include "kinematics.h"
+
+/// The WorkspaceGrid's class is a precomputed occupancy grid of the robot
+/// workspace. The reachability is evaluated at every node of a regular grid
+/// and every voxel is marked as inside (all its corners reachable), outside 
+/// (none reachable) or boundary. Queries inside or outside the workspace are
+/// answered with a bit test, only the boundary voxels need the exact inverse
+/// kinematics.
+class WorkspaceGrid
+{
+public:
+    
+    /// Contains the state of a voxel
+    enum State 
+    {
+        Outside,
+        Inside,
+        Boundary
+    };
+    
+    /// Default constructor, empty grid
+    WorkspaceGrid();
+    
+    /// Evaluates the whole grid, X and Y go from -xyMax to xyMax
+    /// @param k Robot kinematics
+    /// @param xyMax Maximum X and Y absolute value in cm
+    /// @param zMin Minimum Z in cm
+    /// @param zMax Maximum Z in cm
+    /// @param res Voxel size in cm
+    /// @param nodes If not NULL stores the reachability of every node, one
+    /// byte per node with X varying fastest, then Y and then Z
+    void build(const Kinematics &k, double xyMax, double zMin, double zMax, 
+               double res, QVector<uchar> *nodes = NULL);
+    
+    /// Returns true if the grid hasn't been built or loaded
+    inline bool isEmpty() const { return _nx == 0; }
+    
+    /// Returns true if the position can be reached, the boundary voxels 
+    /// and the positions out of the grid use the exact kinematics
+    /// @param k Robot kinematics, must be the used to build the grid
+    bool isReachable(const Kinematics &k, double x, double y, double z) const;
+    
+    /// Loads a grid from a file, it fails if the file was built with other
+    /// geometry, limits or bounds
+    /// @param file Path to the file
+    /// @param k Current robot kinematics
+    /// @param xyMax Expected maximum X and Y absolute value
+    /// @param zMin Expected minimum Z
+    /// @param zMax Expected maximum Z
+    /// @param res Expected voxel size
+    /// @return True if the grid was loaded
+    bool load(QString file, const Kinematics &k, double xyMax, double zMin, 
+              double zMax, double res);
+    
+    /// Saves the grid to a file
+    /// @return True if the grid was saved
+    bool save(QString file, const Kinematics &k) const;
+    
+    /// Saves the reachable nodes as a text file with a "x y z" line per 
+    /// point, the same format as the Matlab workspace script
+    /// @param nodes Node reachability returned by build()
+    /// @return True if the points were saved
+    bool savePoints(QString file, const QVector<uchar> &nodes) const;
+    
+    /// Returns the number of voxels in X and Y
+    inline int width() const { return _nx; }
+    
+    /// Returns the number of voxels in Z
+    inline int height() const { return _nz; }
+    
+    /// Returns the state of the voxel containing the position, Boundary if 
+    /// it's out of the grid
+    inline State state(double x, double y, double z) const
+    {
+        int ix = int((x - _x0)*_inv);
+        int iy = int((y - _x0)*_inv);
+        int iz = int((z - _z0)*_inv);
+        if (x < _x0 or y < _x0 or z < _z0 or 
+            ix >= _nx or iy >= _nx or iz >= _nz) return Boundary;
+        
+        int i = (iz*_nx + iy)*_nx + ix;
+        if (_inside.testBit(i)) return Inside;
+        if (_boundary.testBit(i)) return Boundary;
+        return Outside;
+    }
+    
+private:
+    
+    /// Enum containing all the save file versions
+    enum Version 
+    {
+        v_1_0
+    };
+    
+    /// Voxels with all the corners reachable
+    QBitArray _inside;
+    
+    /// Voxels with some corners reachable
+    QBitArray _boundary;
+    
+    /// Inverse of the voxel size
+    double _inv;
+    
+    /// Number of voxels in X and Y
+    int _nx;
+    
+    /// Number of voxels in Z
+    int _nz;
+    
+    /// Voxel size
+    double _res;
+    
+    /// Minimum X and Y
+    double _x0;
+    
+    /// Minimum Z
+    double _z0;
+    
+    /// Returns the parameters that must match to use a stored grid
+    static QVector<double> signature(const Kinematics &k, double xyMax, 
+                                     double zMin, double zMax, double res);
+};
+
+#endif // WORKSPACEGRID_H